@@ -0,0 +1,242 @@
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include "Cgiparse.hpp"
+#include "Schema.hpp"
+
+static const std::string query =
+    "user=alice&id=1234&page=3&ratio=0.75&tags=a,b,c,d&ids=1,2,3,4,5,6,7,8&"
+    "comment=hello+world%21&sort=desc&unused=xyz&limit=50";
+
+struct GetterArguments : public cgiparse::CgiInputParser<> {
+    std::string user;
+    int64_t id;
+    int page;
+    double ratio;
+    std::vector<std::string> tags;
+    std::vector<int> ids;
+    std::string comment;
+    std::string sort;
+    int limit = 10;
+
+    void Parse(cgiparse::Getter_t &getter) {
+        cgiInput(getter, user, "user");
+        cgiInput(getter, id, "id");
+        cgiInput(getter, page, "page");
+        cgiInput(getter, ratio, "ratio");
+        cgiInput(getter, tags, "tags");
+        cgiInput(getter, ids, "ids");
+        cgiInputOptional(getter, comment, "comment");
+        cgiInputOptional(getter, sort, "sort");
+        cgiInputOptional(getter, limit, "limit");
+    }
+};
+
+struct SchemaArguments : public cgiparse::SchemaInputParser<> {
+    std::string user;
+    int64_t id;
+    int page;
+    double ratio;
+    std::vector<std::string> tags;
+    std::vector<int> ids;
+    std::string comment;
+    std::string sort;
+    int limit = 10;
+};
+
+static constexpr auto schema = cgiparse::MakeSchema<SchemaArguments>(
+    cgiparse::Required(&SchemaArguments::user, "user"),
+    cgiparse::Required(&SchemaArguments::id, "id"),
+    cgiparse::Required(&SchemaArguments::page, "page"),
+    cgiparse::Required(&SchemaArguments::ratio, "ratio"),
+    cgiparse::Required(&SchemaArguments::tags, "tags"),
+    cgiparse::Required(&SchemaArguments::ids, "ids"),
+    cgiparse::Optional(&SchemaArguments::comment, "comment"),
+    cgiparse::Optional(&SchemaArguments::sort, "sort"),
+    cgiparse::Optional(&SchemaArguments::limit, "limit")
+);
+
+struct ScalarArguments : public cgiparse::CgiInputParser<> {
+    int64_t id;
+    int count;
+    double ratio;
+    std::string text;
+
+    void Parse(cgiparse::Getter_t &getter) {
+        cgiInput(getter, id, "id");
+        cgiInput(getter, count, "count");
+        cgiInput(getter, ratio, "ratio");
+        cgiInput(getter, text, "text");
+    }
+};
+
+struct ListArguments : public cgiparse::CgiInputParser<> {
+    std::vector<int> ids;
+
+    void Parse(cgiparse::Getter_t &getter) {
+        cgiInput(getter, ids, "ids");
+    }
+};
+
+// Half of the optional fields are left out of the input
+struct OptionalArguments : public cgiparse::CgiInputParser<> {
+    int64_t id = 0;
+    int count = 0;
+    double ratio = 0;
+    int limit = 10;
+    std::string text;
+    std::string sort;
+
+    void Parse(cgiparse::Getter_t &getter) {
+        cgiInputOptional(getter, id, "id");
+        cgiInputOptional(getter, count, "count");
+        cgiInputOptional(getter, ratio, "ratio");
+        cgiInputOptional(getter, limit, "limit");
+        cgiInputOptional(getter, text, "text");
+        cgiInputOptional(getter, sort, "sort");
+    }
+};
+
+static constexpr auto scalarSchema = cgiparse::MakeSchema<ScalarArguments>(
+    cgiparse::Required(&ScalarArguments::id, "id"),
+    cgiparse::Required(&ScalarArguments::count, "count"),
+    cgiparse::Required(&ScalarArguments::ratio, "ratio"),
+    cgiparse::Required(&ScalarArguments::text, "text")
+);
+
+static constexpr auto listSchema = cgiparse::MakeSchema<ListArguments>(
+    cgiparse::Required(&ListArguments::ids, "ids")
+);
+
+static constexpr auto optionalSchema = cgiparse::MakeSchema<OptionalArguments>(
+    cgiparse::Optional(&OptionalArguments::id, "id"),
+    cgiparse::Optional(&OptionalArguments::count, "count"),
+    cgiparse::Optional(&OptionalArguments::ratio, "ratio"),
+    cgiparse::Optional(&OptionalArguments::limit, "limit"),
+    cgiparse::Optional(&OptionalArguments::text, "text"),
+    cgiparse::Optional(&OptionalArguments::sort, "sort")
+);
+
+// Pads the text value so the whole query is about `size` bytes
+std::string scalarQuery(std::size_t size) {
+    std::string query = "id=1234567890&count=42&ratio=0.75&text=";
+    query.append(size > query.size() ? size - query.size() : 1, 'x');
+    return query;
+}
+
+// Fields counts list elements, as every element goes through the deserializer
+std::string listQuery(std::size_t size, std::size_t &fields) {
+    std::string query = "ids=";
+    fields = 0;
+    while (query.size() < size || fields == 0) {
+        if (fields > 0) query += ',';
+        query += std::to_string(fields * 7919 % 100000);
+        ++fields;
+    }
+    return query;
+}
+
+std::string optionalQuery(std::size_t size) {
+    std::string query = "id=1234567890&ratio=0.75&text=";
+    query.append(size > query.size() ? size - query.size() : 1, 'x');
+    return query;
+}
+
+// Seconds per call, repeating the call until at least `minimum` seconds have passed
+template<typename Function_T>
+double secondsPerCall(Function_T &&function, double minimum = 0.1) {
+    std::size_t iterations = 1;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i) {
+            function();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= minimum) return elapsed / iterations;
+        iterations *= elapsed > 0 ? std::min<std::size_t>(100, static_cast<std::size_t>(minimum / elapsed) + 1) : 100;
+    }
+}
+
+void reportThroughput(const char *kind, const char *path, const std::string &query, std::size_t fields, double seconds, bool errors) {
+    std::cout << std::left << std::setw(10) << kind << std::setw(8) << path
+              << std::right << std::setw(10) << query.size()
+              << std::setw(12) << std::fixed << std::setprecision(1) << query.size() / seconds / (1024 * 1024)
+              << std::setw(14) << std::setprecision(0) << fields / seconds
+              << std::defaultfloat << (errors ? "  (errors)" : "") << "\n";
+}
+
+/**
+ * Parses scalar, list and optional inputs of growing size through the getter
+ * path (QueryIndex lookups) and the schema path, in MB/s of query string and
+ * fields/s.
+ */
+template<typename Arguments_T, typename Schema_T>
+void throughput(const char *kind, const std::string &query, std::size_t fields, const Schema_T &schema) {
+    Arguments_T getterArgs;
+    cgiparse::QueryIndex index;
+    cgiparse::Getter_t getter = index.Getter();
+    double getterSeconds = secondsPerCall([&]() {
+        index.Parse(query);
+        getterArgs.GetCgiArgs(getter);
+    });
+    reportThroughput(kind, "getter", query, fields, getterSeconds, getterArgs.HasErrors());
+
+    Arguments_T schemaArgs;
+    double schemaSeconds = secondsPerCall([&]() {
+        schemaArgs.GetCgiArgs(schema, query);
+    });
+    reportThroughput(kind, "schema", query, fields, schemaSeconds, schemaArgs.HasErrors());
+}
+
+template<typename Function_T>
+double nanosecondsPerCall(std::size_t iterations, Function_T &&function) {
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        function();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+int main(int argc, char **argv) {
+    std::size_t iterations = argc > 1 ? std::stoull(argv[1]) : 200000;
+
+    // What a getter based CGI program does: index the query string, then look up every key
+    GetterArguments getterArgs;
+    cgiparse::QueryIndex index;
+    cgiparse::Getter_t getter = index.Getter();
+    double getterNs = nanosecondsPerCall(iterations, [&]() {
+        index.Parse(query);
+        getterArgs.GetCgiArgs(getter);
+    });
+
+    SchemaArguments schemaArgs;
+    double schemaNs = nanosecondsPerCall(iterations, [&schemaArgs]() {
+        schemaArgs.GetCgiArgs(schema, query);
+    });
+
+    if (getterArgs.HasErrors() || schemaArgs.HasErrors() || getterArgs.ids != schemaArgs.ids || getterArgs.comment != schemaArgs.comment) {
+        std::cout << "parsers disagree on the input\n";
+        return 1;
+    }
+
+    std::cout << "getter Parse(): " << getterNs << " ns/parse\n";
+    std::cout << "schema:         " << schemaNs << " ns/parse\n";
+    std::cout << "getter/schema:  " << getterNs / schemaNs << "x\n\n";
+
+    std::cout << std::left << std::setw(10) << "fields" << std::setw(8) << "path"
+              << std::right << std::setw(10) << "bytes" << std::setw(12) << "MB/s" << std::setw(14) << "fields/s" << "\n";
+    for (std::size_t size : { 64, 1024, 16 * 1024, 256 * 1024 }) {
+        throughput<ScalarArguments>("scalar", scalarQuery(size), 4, scalarSchema);
+    }
+    for (std::size_t size : { 64, 1024, 16 * 1024, 256 * 1024 }) {
+        std::size_t fields;
+        std::string query = listQuery(size, fields);
+        throughput<ListArguments>("list", query, fields, listSchema);
+    }
+    for (std::size_t size : { 64, 1024, 16 * 1024, 256 * 1024 }) {
+        throughput<OptionalArguments>("optional", optionalQuery(size), 6, optionalSchema);
+    }
+
+    return 0;
+}
@@ -2,6 +2,7 @@
 #define CGIPARSE_H_adkasdlkasdaooiwe230123fec
 
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <vector>
 #include <algorithm>
@@ -9,7 +10,6 @@
 #include <functional>
 #include <iterator>
 #include <sstream>
-#include <map>
 
 namespace cgiparse {
 
@@ -22,6 +22,16 @@ namespace cgiparse {
         OUT_OF_RANGE
     };
 
+    inline const char *ToString(CgiInputErrorTypes type) {
+        switch (type) {
+            case CgiInputErrorTypes::OK: return "ok";
+            case CgiInputErrorTypes::MISSING: return "missing";
+            case CgiInputErrorTypes::INVALID_ARGUMENT: return "invalid argument";
+            case CgiInputErrorTypes::OUT_OF_RANGE: return "out of range";
+        }
+        return "unknown";
+    }
+
     struct DefaultDeserializer {
 
         template<typename T, typename std::enable_if<std::is_signed<T>::value && !std::is_floating_point<T>::value, int>::type = 0>
@@ -82,14 +92,199 @@ namespace cgiparse {
         return in_stream;
     }
 
-    template<typename Deserializer_T = DefaultDeserializer>
-    class CgiInputParser {
-        struct CgiInputError {
-            CgiInputErrorTypes type;
-            std::size_t index;
+    struct CgiInputError {
+        std::size_t field;
+        CgiInputErrorTypes type;
+        std::size_t index;
+    };
+
+    /**
+     * A vector that keeps its first N elements inline and only moves to the
+     * heap when it outgrows them. After that the heap storage is kept, so a
+     * cleared vector does not allocate again.
+     */
+    template<typename T, std::size_t N>
+    class SmallVector {
+    public:
+        void push_back(const T &value) {
+            if (!m_spilled && m_size < N) {
+                m_inline[m_size++] = value;
+                return;
+            }
+            if (!m_spilled) {
+                m_heap.reserve(N * 2);
+                m_heap.assign(m_inline, m_inline + m_size);
+                m_spilled = true;
+            }
+            m_heap.push_back(value);
+        }
+
+        void clear() {
+            m_size = 0;
+            m_heap.clear();
+        }
+
+        std::size_t size() const {
+            return m_spilled ? m_heap.size() : m_size;
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        const T *begin() const {
+            return m_spilled ? m_heap.data() : m_inline;
+        }
+
+        const T *end() const {
+            return begin() + size();
+        }
+
+    private:
+        T m_inline[N];
+        std::size_t m_size = 0;
+        bool m_spilled = false;
+        std::vector<T> m_heap;
+    };
+
+    struct CgiInputErrorEntry {
+        std::string_view key;
+        CgiInputErrorTypes type;
+        std::size_t index;
+        std::size_t field;
+    };
+
+    /**
+     * A view of the errors of the last parse, one entry per bad element.
+     */
+    class CgiInputErrorList {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = CgiInputErrorEntry;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = CgiInputErrorEntry;
+
+            iterator(const CgiInputError *at, const std::vector<std::string> *keys) : m_at(at), m_keys(keys) {}
+
+            CgiInputErrorEntry operator*() const {
+                return CgiInputErrorEntry{ (*m_keys)[m_at->field], m_at->type, m_at->index, m_at->field };
+            }
+
+            iterator &operator++() {
+                ++m_at;
+                return *this;
+            }
+
+            iterator operator++(int) {
+                iterator old = *this;
+                ++m_at;
+                return old;
+            }
+
+            bool operator==(const iterator &other) const {
+                return m_at == other.m_at;
+            }
+
+            bool operator!=(const iterator &other) const {
+                return m_at != other.m_at;
+            }
+
+        private:
+            const CgiInputError *m_at;
+            const std::vector<std::string> *m_keys;
         };
+
+        CgiInputErrorList(const CgiInputError *begin, const CgiInputError *end, const std::vector<std::string> *keys)
+            : m_begin(begin), m_end(end), m_keys(keys) {}
+
+        iterator begin() const {
+            return iterator(m_begin, m_keys);
+        }
+
+        iterator end() const {
+            return iterator(m_end, m_keys);
+        }
+
+        std::size_t size() const {
+            return static_cast<std::size_t>(m_end - m_begin);
+        }
+
+        bool empty() const {
+            return m_begin == m_end;
+        }
+
+    private:
+        const CgiInputError *m_begin;
+        const CgiInputError *m_end;
+        const std::vector<std::string> *m_keys;
+    };
+
+    /**
+     * Keeps the errors of the last parse and parses urlencoded input with a
+     * cgiparse::Schema (see Schema.hpp). Parsers described only by a schema
+     * derive from this, CgiInputParser adds the getter based Parse.
+     */
+    template<typename Deserializer_T = DefaultDeserializer>
+    class SchemaInputParser {
+    public:
+        virtual ~SchemaInputParser() = default;
+
+        /**
+         * Parses an urlencoded input in one scan using a cgiparse::Schema
+         * instead of getter lookups.
+         */
+        template<typename Schema_T>
+        void GetCgiArgs(const Schema_T &schema, std::string_view input) {
+            resetErrors();
+            schema.Parse(static_cast<typename Schema_T::Object_t &>(*this), input, m_deserializer, m_scratch,
+                [this](std::size_t field, std::string_view key, CgiInputErrorTypes type, std::size_t index) {
+                    addError(field, key, type, index);
+                });
+        }
+
+        bool HasErrors() const {
+            return !m_errors.empty();
+        }
+
+        /**
+         * Every bad input of the last parse, in the order they were found.
+         * List inputs report one entry per bad element.
+         */
+        CgiInputErrorList getErrors() const {
+            return CgiInputErrorList(m_errors.begin(), m_errors.end(), &m_keys);
+        }
+
+    protected:
+        Deserializer_T m_deserializer;
+        std::size_t m_field = 0;
+
+        void resetErrors() {
+            m_errors.clear();
+            m_field = 0;
+        }
+
+        // The key is only copied when there is an error, into a string that keeps its capacity
+        void addError(std::size_t field, std::string_view key, CgiInputErrorTypes type, std::size_t index) {
+            if (field >= m_keys.size()) m_keys.resize(field + 1);
+            m_keys[field].assign(key.data(), key.size());
+            m_errors.push_back(CgiInputError{ field, type, index });
+        }
+
+    private:
+        SmallVector<CgiInputError, 16> m_errors;
+        std::vector<std::string> m_keys;
+        std::string m_scratch;
+    };
+
+    template<typename Deserializer_T = DefaultDeserializer>
+    class CgiInputParser : public SchemaInputParser<Deserializer_T> {
+        using Base_t = SchemaInputParser<Deserializer_T>;
+
     public:
-        virtual ~CgiInputParser() = default;
+        using Base_t::GetCgiArgs;
 
         void GetCgiArgs(cgiparse::Getter_t &getter) {
             resetErrors();
@@ -101,40 +296,37 @@ namespace cgiparse {
             Parse(getter);
         }
 
-        bool HasErrors() {
-            return m_errors.size() > 0;
-        }
-
-        std::map<std::string, CgiInputError> &getErrors() {
-            return m_errors;
-        }
-
     protected:
+        using Base_t::m_deserializer;
+        using Base_t::m_field;
+        using Base_t::resetErrors;
+        using Base_t::addError;
+
         virtual void Parse(cgiparse::Getter_t &getter) = 0;
 
         template<typename T, typename std::enable_if<!std::is_floating_point<T>::value, int>::type = 0>
         void cgiInput(cgiparse::Getter_t &getter, T &argument, const std::string &key, int base = 10, std::size_t *pos = 0) {
+            std::size_t field = m_field++;
             auto str = getter(key);
             auto result = m_deserializer.deserialize(argument, str, base, pos);
             if (result != CgiInputErrorTypes::OK) {
-                m_errors.emplace(std::make_pair(key, CgiInputError{ result, 0 }));
+                addError(field, key, result, 0);
             }
         }
 
         template<typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
         void cgiInput(cgiparse::Getter_t &getter, T &argument, const std::string &key, std::size_t *pos = 0) {
+            std::size_t field = m_field++;
             auto str = getter(key);
             auto result = m_deserializer.deserialize(argument, str, pos);
             if (result != CgiInputErrorTypes::OK) {
-                CgiInputError o = {};
-                o.type = result;
-                o.index = 0;
-                m_errors.emplace(std::make_pair(key, o));
+                addError(field, key, result, 0);
             }
         }
 
         template<typename T, char delimiter = ',', typename std::enable_if<!std::is_floating_point<T>::value, int>::type = 0>
         void cgiInput(cgiparse::Getter_t &getter, std::vector<T> &argument, const std::string &key, int base = 10, std::size_t *pos = 0) {
+            std::size_t field = m_field++;
             std::string str = getter(key);
             std::istringstream iss(str);
 
@@ -148,16 +340,14 @@ namespace cgiparse {
             for (size_t i = 0; i < splitted.size(); ++i) {
                 CgiInputErrorTypes result = m_deserializer.deserialize(argument[i], splitted[i], base, pos);
                 if (result != CgiInputErrorTypes::OK) {
-                    CgiInputError o = {};
-                    o.type = result;
-                    o.index = i;
-                    m_errors.emplace(std::make_pair(key, o));
+                    addError(field, key, result, i);
                 }
             }
         }
 
         template<typename T, char delimiter = ',', typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
         void cgiInput(cgiparse::Getter_t &getter, std::vector<T> &argument, const std::string &key, std::size_t *pos = 0) {
+            std::size_t field = m_field++;
             std::string str = getter(key);
             std::istringstream iss(str);
 
@@ -171,16 +361,14 @@ namespace cgiparse {
             for (size_t i = 0; i < splitted.size(); ++i) {
                 CgiInputErrorTypes result = m_deserializer.deserialize(argument[i], splitted[i], pos);
                 if (result != CgiInputErrorTypes::OK) {
-                    CgiInputError o = {};
-                    o.type = result;
-                    o.index = i;
-                    m_errors.emplace(std::make_pair(key, o));
+                    addError(field, key, result, i);
                 }
             }
         }
 
         template<char delimiter = ','>
         void cgiInput(cgiparse::Getter_t &getter, std::vector<std::string> &argument, const std::string &key, std::size_t *pos = 0) {
+            std::size_t field = m_field++;
             std::string str = getter(key);
             std::istringstream iss(str);
 
@@ -193,51 +381,43 @@ namespace cgiparse {
             for (size_t i = 0; i < splitted.size(); ++i) {
                 CgiInputErrorTypes result = m_deserializer.deserialize(argument[i], splitted[i]);
                 if (result != CgiInputErrorTypes::OK) {
-                    CgiInputError o = {};
-                    o.type = result;
-                    o.index = i;
-                    m_errors.emplace(std::make_pair(key, o));
+                    addError(field, key, result, i);
                 }
             }
         }
 
         void cgiInput(cgiparse::Getter_t &getter, std::string &argument, const std::string &key) {
+            std::size_t field = m_field++;
             auto str = getter(key);
             auto result = m_deserializer.deserialize(argument, str);
             if (result != CgiInputErrorTypes::OK) {
-                CgiInputError o = {};
-                o.type = result;
-                o.index = 0;
-                m_errors.emplace(std::make_pair(key, o));
+                addError(field, key, result, 0);
             }
         }
 
         template<typename T, typename std::enable_if<!std::is_floating_point<T>::value, int>::type = 0>
         void cgiInputOptional(cgiparse::Getter_t &getter, T &argument, const std::string &key, int base = 10, std::size_t *pos = 0) {
+            std::size_t field = m_field++;
             auto str = getter(key);
             auto result = m_deserializer.deserialize(argument, str, base, pos);
             if (result != CgiInputErrorTypes::OK && result != CgiInputErrorTypes::MISSING) {
-                CgiInputError o = {};
-                o.type = result;
-                o.index = 0;
-                m_errors.emplace(std::make_pair(key, o));
+                addError(field, key, result, 0);
             }
         }
 
         template<typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
         void cgiInputOptional(cgiparse::Getter_t &getter, T &argument, const std::string &key, std::size_t *pos = 0) {
+            std::size_t field = m_field++;
             auto str = getter(key);
             auto result = m_deserializer.deserialize(argument, str, pos);
             if (result != CgiInputErrorTypes::OK && result != CgiInputErrorTypes::MISSING) {
-                CgiInputError o = {};
-                o.type = result;
-                o.index = 0;
-                m_errors.emplace(std::make_pair(key, o));
+                addError(field, key, result, 0);
             }
         }
 
         template<typename T, char delimiter = ',', typename std::enable_if<!std::is_floating_point<T>::value, int>::type = 0>
         void cgiInputOptional(cgiparse::Getter_t &getter, std::vector<T> &argument, const std::string &key, int base = 10, std::size_t *pos = 0) {
+            std::size_t field = m_field++;
             std::string str = getter(key);
             std::istringstream iss(str);
 
@@ -250,16 +430,14 @@ namespace cgiparse {
             for (size_t i = 0; i < splitted.size(); ++i) {
                 CgiInputErrorTypes result = m_deserializer.deserialize(argument[i], splitted[i], base, pos);
                 if (result != CgiInputErrorTypes::OK && result != CgiInputErrorTypes::MISSING) {
-                    CgiInputError o = {};
-                    o.type = result;
-                    o.index = i;
-                    m_errors.emplace(std::make_pair(key, o));
+                    addError(field, key, result, i);
                 }
             }
         }
 
         template<typename T, char delimiter = ',', typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
         void cgiInputOptional(cgiparse::Getter_t &getter, std::vector<T> &argument, const std::string &key, std::size_t *pos = 0) {
+            std::size_t field = m_field++;
             std::string str = getter(key);
             std::istringstream iss(str);
 
@@ -273,16 +451,14 @@ namespace cgiparse {
             for (size_t i = 0; i < splitted.size(); ++i) {
                 CgiInputErrorTypes result = m_deserializer.deserialize(argument[i], splitted[i], pos);
                 if (result != CgiInputErrorTypes::OK && result != CgiInputErrorTypes::MISSING) {
-                    CgiInputError o = {};
-                    o.type = result;
-                    o.index = i;
-                    m_errors.emplace(std::make_pair(key, o));
+                    addError(field, key, result, i);
                 }
             }
         }
 
         template<char delimiter = ','>
         void cgiInputOptional(cgiparse::Getter_t &getter, std::vector<std::string> &argument, const std::string &key, std::size_t *pos = 0) {
+            std::size_t field = m_field++;
             std::string str = getter(key);
             std::istringstream iss(str);
 
@@ -296,32 +472,19 @@ namespace cgiparse {
             for (size_t i = 0; i < splitted.size(); ++i) {
                 CgiInputErrorTypes result = m_deserializer.deserialize(argument[i], splitted[i]);
                 if (result != CgiInputErrorTypes::OK && result != CgiInputErrorTypes::MISSING) {
-                    CgiInputError o = {};
-                    o.type = result;
-                    o.index = i;
-                    m_errors.emplace(std::make_pair(key, o));
+                    addError(field, key, result, i);
                 }
             }
         }
 
         void cgiInputOptional(cgiparse::Getter_t &getter, std::string &argument, const std::string &key) {
+            std::size_t field = m_field++;
             auto str = getter(key);
             auto result = m_deserializer.deserialize(argument, str);
             if (result != CgiInputErrorTypes::OK && result != CgiInputErrorTypes::MISSING) {
-                CgiInputError o = {};
-                o.type = result;
-                o.index = 0;
-                m_errors.emplace(std::make_pair(key, o));
+                addError(field, key, result, 0);
             }
         }
-
-    private:
-        Deserializer_T m_deserializer;
-        std::map<std::string, CgiInputError> m_errors;
-
-        void resetErrors() {
-            m_errors.clear();
-        }
     };
 
 }
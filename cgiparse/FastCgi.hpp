@@ -0,0 +1,581 @@
+#ifndef CGIPARSE_FASTCGI_H_z81kq4mcn2a0wpe7dlv3sb9
+#define CGIPARSE_FASTCGI_H_z81kq4mcn2a0wpe7dlv3sb9
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Cgiparse.hpp"
+#include "Urlencoded.hpp"
+
+namespace cgiparse {
+
+    namespace fcgi {
+        const std::uint8_t VERSION_1 = 1;
+        const std::size_t HEADER_LEN = 8;
+        const std::size_t MAX_CONTENT_LEN = 65535;
+
+        enum RecordType : std::uint8_t {
+            BEGIN_REQUEST = 1,
+            ABORT_REQUEST = 2,
+            END_REQUEST = 3,
+            PARAMS = 4,
+            STDIN = 5,
+            STDOUT = 6,
+            STDERR = 7,
+            DATA = 8,
+            GET_VALUES = 9,
+            GET_VALUES_RESULT = 10,
+            UNKNOWN_TYPE = 11
+        };
+
+        enum Role : std::uint16_t {
+            RESPONDER = 1,
+            AUTHORIZER = 2,
+            FILTER = 3
+        };
+
+        enum ProtocolStatus : std::uint8_t {
+            REQUEST_COMPLETE = 0,
+            CANT_MPX_CONN = 1,
+            OVERLOADED = 2,
+            UNKNOWN_ROLE = 3
+        };
+
+        const std::uint8_t KEEP_CONN = 1;
+
+        struct RecordHeader {
+            std::uint8_t version;
+            std::uint8_t type;
+            std::uint16_t requestId;
+            std::uint16_t contentLength;
+            std::uint8_t paddingLength;
+        };
+
+        inline RecordHeader ReadHeader(const char *data) {
+            const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+            RecordHeader header;
+            header.version = bytes[0];
+            header.type = bytes[1];
+            header.requestId = static_cast<std::uint16_t>((bytes[2] << 8) | bytes[3]);
+            header.contentLength = static_cast<std::uint16_t>((bytes[4] << 8) | bytes[5]);
+            header.paddingLength = bytes[6];
+            return header;
+        }
+
+        /**
+         * Appends one record, padded to a multiple of 8 bytes.
+         */
+        inline void AppendRecord(std::string &out, std::uint8_t type, std::uint16_t requestId, const char *data, std::size_t size) {
+            std::uint8_t padding = static_cast<std::uint8_t>((8 - (size % 8)) % 8);
+            char header[HEADER_LEN] = {
+                static_cast<char>(VERSION_1),
+                static_cast<char>(type),
+                static_cast<char>(requestId >> 8),
+                static_cast<char>(requestId & 0xff),
+                static_cast<char>(size >> 8),
+                static_cast<char>(size & 0xff),
+                static_cast<char>(padding),
+                0
+            };
+            out.append(header, HEADER_LEN);
+            out.append(data, size);
+            out.append(padding, '\0');
+        }
+
+        /**
+         * Appends a stream as records of at most MAX_CONTENT_LEN bytes followed
+         * by the empty record that closes the stream.
+         */
+        inline void AppendStream(std::string &out, std::uint8_t type, std::uint16_t requestId, std::string_view data) {
+            while (!data.empty()) {
+                std::size_t size = std::min(data.size(), MAX_CONTENT_LEN);
+                AppendRecord(out, type, requestId, data.data(), size);
+                data.remove_prefix(size);
+            }
+            AppendRecord(out, type, requestId, nullptr, 0);
+        }
+
+        inline void AppendNameValue(std::string &out, std::string_view name, std::string_view value) {
+            auto appendLength = [&out](std::size_t length) {
+                if (length < 128) {
+                    out.push_back(static_cast<char>(length));
+                } else {
+                    out.push_back(static_cast<char>(((length >> 24) & 0x7f) | 0x80));
+                    out.push_back(static_cast<char>((length >> 16) & 0xff));
+                    out.push_back(static_cast<char>((length >> 8) & 0xff));
+                    out.push_back(static_cast<char>(length & 0xff));
+                }
+            };
+            appendLength(name.size());
+            appendLength(value.size());
+            out.append(name.data(), name.size());
+            out.append(value.data(), value.size());
+        }
+
+        /**
+         * Walks the name-value pairs of a PARAMS or GET_VALUES stream. Returns
+         * false if the stream is truncated.
+         */
+        template<typename Function_T>
+        bool ForEachNameValue(std::string_view data, Function_T &&function) {
+            auto readLength = [&data](std::size_t &length) {
+                if (data.empty()) return false;
+                unsigned char first = static_cast<unsigned char>(data[0]);
+                if (first < 128) {
+                    length = first;
+                    data.remove_prefix(1);
+                    return true;
+                }
+                if (data.size() < 4) return false;
+                const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data.data());
+                length = (static_cast<std::size_t>(bytes[0] & 0x7f) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+                data.remove_prefix(4);
+                return true;
+            };
+
+            while (!data.empty()) {
+                std::size_t nameLength, valueLength;
+                if (!readLength(nameLength) || !readLength(valueLength)) return false;
+                if (data.size() < nameLength + valueLength) return false;
+                function(data.substr(0, nameLength), data.substr(nameLength, valueLength));
+                data.remove_prefix(nameLength + valueLength);
+            }
+            return true;
+        }
+    }
+
+    /**
+     * One FastCGI request. Requests are pooled by the connection, so the
+     * strings keep their capacity from one request to the next.
+     */
+    class FastCgiRequest {
+        template<typename Parser_T> friend class FastCgiConnection;
+    public:
+        std::uint16_t Id() const {
+            return m_id;
+        }
+
+        /**
+         * Returns a CGI parameter such as QUERY_STRING, or nullptr.
+         */
+        const std::string *Param(std::string_view name) const {
+            for (std::size_t i = 0; i < m_paramCount; ++i) {
+                if (m_params[i].first == name) return &m_params[i].second;
+            }
+            return nullptr;
+        }
+
+        const std::string &Stdin() const {
+            return m_stdin;
+        }
+
+        /**
+         * Getter over the decoded QUERY_STRING, or over the body for
+         * application/x-www-form-urlencoded POST requests.
+         */
+        cgiparse::Getter_t Getter() {
+            const std::string *contentType = Param("CONTENT_TYPE");
+            if (contentType && contentType->compare(0, 33, "application/x-www-form-urlencoded") == 0) {
+                m_query.Parse(m_stdin);
+            } else {
+                const std::string *query = Param("QUERY_STRING");
+                m_query.Parse(query ? std::string_view(*query) : std::string_view());
+            }
+            return m_query.Getter();
+        }
+
+        /**
+         * The response, headers included, e.g. "Content-Type: text/plain\r\n\r\nhello".
+         */
+        std::string &Out() {
+            return m_stdout;
+        }
+
+        std::string &Err() {
+            return m_stderr;
+        }
+
+        void SetAppStatus(std::uint32_t status) {
+            m_appStatus = status;
+        }
+
+    private:
+        std::uint16_t m_id = 0;
+        bool m_active = false;
+        bool m_keepConnection = false;
+        bool m_paramsDone = false;
+        std::uint32_t m_appStatus = 0;
+
+        std::string m_paramsRaw;
+        std::vector<std::pair<std::string, std::string>> m_params;
+        std::size_t m_paramCount = 0;
+        std::string m_stdin;
+        std::string m_stdout;
+        std::string m_stderr;
+        QueryIndex m_query;
+
+        void reset(std::uint16_t id, bool keepConnection) {
+            m_id = id;
+            m_active = true;
+            m_keepConnection = keepConnection;
+            m_paramsDone = false;
+            m_appStatus = 0;
+            m_paramsRaw.clear();
+            m_paramCount = 0;
+            m_stdin.clear();
+            m_stdout.clear();
+            m_stderr.clear();
+        }
+
+        bool decodeParams() {
+            return fcgi::ForEachNameValue(m_paramsRaw, [this](std::string_view name, std::string_view value) {
+                if (m_paramCount == m_params.size()) m_params.emplace_back();
+                auto &param = m_params[m_paramCount++];
+                param.first.assign(name.data(), name.size());
+                param.second.assign(value.data(), value.size());
+            });
+        }
+    };
+
+    /**
+     * The protocol side of a FastCGI connection, independent of the socket.
+     * Bytes from the web server go into Feed, completed requests are handed to
+     * the handler together with the long lived parser, and the bytes to send
+     * back are collected in Output. Requests are multiplexed by request id.
+     */
+    template<typename Parser_T>
+    class FastCgiConnection {
+    public:
+        using Handler_t = std::function<void (FastCgiRequest &request, Parser_T &parser)>;
+
+        FastCgiConnection(Parser_T &parser, Handler_t handler, std::size_t maxRequests = 64)
+            : m_parser(parser)
+            , m_handler(std::move(handler))
+            , m_maxRequests(maxRequests) {}
+
+        /**
+         * Processes the bytes received so far. Returns false on a protocol
+         * error, after which the connection should be closed.
+         */
+        bool Feed(const char *data, std::size_t size) {
+            m_input.append(data, size);
+
+            std::size_t pos = 0;
+            while (m_input.size() - pos >= fcgi::HEADER_LEN) {
+                fcgi::RecordHeader header = fcgi::ReadHeader(m_input.data() + pos);
+                if (header.version != fcgi::VERSION_1) return false;
+
+                std::size_t length = fcgi::HEADER_LEN + header.contentLength + header.paddingLength;
+                if (m_input.size() - pos < length) break;
+
+                handleRecord(header, std::string_view(m_input).substr(pos + fcgi::HEADER_LEN, header.contentLength));
+                pos += length;
+            }
+            m_input.erase(0, pos);
+            return true;
+        }
+
+        std::string &Output() {
+            return m_output;
+        }
+
+        /**
+         * True once a request without FCGI_KEEP_CONN has been answered.
+         */
+        bool ShouldClose() const {
+            return m_close;
+        }
+
+        void Reset() {
+            m_input.clear();
+            m_output.clear();
+            m_close = false;
+            for (auto &request : m_requests) {
+                request.m_active = false;
+            }
+        }
+
+    private:
+        Parser_T &m_parser;
+        Handler_t m_handler;
+        std::size_t m_maxRequests;
+
+        std::string m_input;
+        std::string m_output;
+        std::vector<FastCgiRequest> m_requests;
+        bool m_close = false;
+
+        FastCgiRequest *findRequest(std::uint16_t id) {
+            for (auto &request : m_requests) {
+                if (request.m_active && request.m_id == id) return &request;
+            }
+            return nullptr;
+        }
+
+        FastCgiRequest *allocateRequest() {
+            std::size_t active = 0;
+            for (auto &request : m_requests) {
+                if (!request.m_active) return &request;
+                ++active;
+            }
+            if (active >= m_maxRequests) return nullptr;
+            m_requests.emplace_back();
+            return &m_requests.back();
+        }
+
+        void handleRecord(const fcgi::RecordHeader &header, std::string_view content) {
+            if (header.requestId == 0) {
+                handleManagementRecord(header, content);
+                return;
+            }
+
+            if (header.type == fcgi::BEGIN_REQUEST) {
+                if (content.size() < 8) return;
+                std::uint16_t role = static_cast<std::uint16_t>((static_cast<unsigned char>(content[0]) << 8) | static_cast<unsigned char>(content[1]));
+                bool keepConnection = (content[2] & fcgi::KEEP_CONN) != 0;
+
+                if (role != fcgi::RESPONDER) {
+                    endRequest(header.requestId, 0, fcgi::UNKNOWN_ROLE, keepConnection);
+                    return;
+                }
+                FastCgiRequest *request = allocateRequest();
+                if (!request) {
+                    endRequest(header.requestId, 0, fcgi::OVERLOADED, keepConnection);
+                    return;
+                }
+                request->reset(header.requestId, keepConnection);
+                return;
+            }
+
+            // Records for requests we do not know about are ignored, as required by the spec
+            FastCgiRequest *request = findRequest(header.requestId);
+            if (!request) return;
+
+            switch (header.type) {
+            case fcgi::ABORT_REQUEST:
+                request->m_active = false;
+                endRequest(request->m_id, 0, fcgi::REQUEST_COMPLETE, request->m_keepConnection);
+                break;
+            case fcgi::PARAMS:
+                if (content.empty()) {
+                    request->m_paramsDone = true;
+                    if (!request->decodeParams()) {
+                        request->m_active = false;
+                        endRequest(request->m_id, 1, fcgi::REQUEST_COMPLETE, request->m_keepConnection);
+                    }
+                } else {
+                    request->m_paramsRaw.append(content.data(), content.size());
+                }
+                break;
+            case fcgi::STDIN:
+                if (content.empty()) {
+                    if (request->m_paramsDone) respond(*request);
+                } else {
+                    request->m_stdin.append(content.data(), content.size());
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        void handleManagementRecord(const fcgi::RecordHeader &header, std::string_view content) {
+            if (header.type == fcgi::GET_VALUES) {
+                std::string values;
+                fcgi::ForEachNameValue(content, [this, &values](std::string_view name, std::string_view) {
+                    if (name == "FCGI_MAX_CONNS") {
+                        fcgi::AppendNameValue(values, name, "1");
+                    } else if (name == "FCGI_MAX_REQS") {
+                        fcgi::AppendNameValue(values, name, std::to_string(m_maxRequests));
+                    } else if (name == "FCGI_MPXS_CONNS") {
+                        fcgi::AppendNameValue(values, name, "1");
+                    }
+                });
+                fcgi::AppendRecord(m_output, fcgi::GET_VALUES_RESULT, 0, values.data(), values.size());
+            } else {
+                char body[8] = { static_cast<char>(header.type), 0, 0, 0, 0, 0, 0, 0 };
+                fcgi::AppendRecord(m_output, fcgi::UNKNOWN_TYPE, 0, body, sizeof(body));
+            }
+        }
+
+        void respond(FastCgiRequest &request) {
+            try {
+                m_handler(request, m_parser);
+            } catch (const std::exception &e) {
+                request.m_stdout.clear();
+                request.m_stderr += e.what();
+                request.m_appStatus = 1;
+            }
+
+            fcgi::AppendStream(m_output, fcgi::STDOUT, request.m_id, request.m_stdout);
+            if (!request.m_stderr.empty()) {
+                fcgi::AppendStream(m_output, fcgi::STDERR, request.m_id, request.m_stderr);
+            }
+            request.m_active = false;
+            endRequest(request.m_id, request.m_appStatus, fcgi::REQUEST_COMPLETE, request.m_keepConnection);
+        }
+
+        void endRequest(std::uint16_t id, std::uint32_t appStatus, std::uint8_t protocolStatus, bool keepConnection) {
+            char body[8] = {
+                static_cast<char>(appStatus >> 24),
+                static_cast<char>((appStatus >> 16) & 0xff),
+                static_cast<char>((appStatus >> 8) & 0xff),
+                static_cast<char>(appStatus & 0xff),
+                static_cast<char>(protocolStatus),
+                0, 0, 0
+            };
+            fcgi::AppendRecord(m_output, fcgi::END_REQUEST, id, body, sizeof(body));
+            if (!keepConnection) m_close = true;
+        }
+    };
+
+    /**
+     * A persistent FastCGI responder. The process, the parser and all request
+     * buffers outlive the individual requests. Connections are served one at
+     * a time, requests within a connection may be multiplexed.
+     */
+    template<typename Parser_T>
+    class FastCgiResponder {
+    public:
+        using Handler_t = typename FastCgiConnection<Parser_T>::Handler_t;
+
+        explicit FastCgiResponder(Handler_t handler, std::size_t maxRequests = 64)
+            : m_connection(m_parser, std::move(handler), maxRequests)
+            , m_buffer(64 * 1024) {}
+
+        ~FastCgiResponder() {
+            closeListener();
+        }
+
+        FastCgiResponder(const FastCgiResponder &) = delete;
+        FastCgiResponder &operator=(const FastCgiResponder &) = delete;
+
+        bool ListenUnix(const std::string &path, int backlog = 128) {
+            sockaddr_un address = {};
+            if (path.size() >= sizeof(address.sun_path)) return false;
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+            ::unlink(path.c_str());
+            return listenOn(AF_UNIX, reinterpret_cast<sockaddr *>(&address), sizeof(address), backlog);
+        }
+
+        bool ListenTcp(std::uint16_t port, const std::string &host = "127.0.0.1", int backlog = 128) {
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            if (::inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) return false;
+            return listenOn(AF_INET, reinterpret_cast<sockaddr *>(&address), sizeof(address), backlog);
+        }
+
+        /**
+         * Uses an already listening socket, e.g. the FCGI_LISTENSOCK_FILENO (0)
+         * that a web server passes to the FastCGI processes it spawns. The
+         * caller keeps ownership, the responder never closes it.
+         */
+        void Listen(int fd) {
+            closeListener();
+            m_listenFd = fd;
+        }
+
+        /**
+         * Accepts and serves connections until Stop is called.
+         */
+        void Run() {
+            m_running = true;
+            while (m_running) {
+                int fd = ::accept(m_listenFd, nullptr, nullptr);
+                if (fd < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+                Serve(fd);
+                ::close(fd);
+            }
+        }
+
+        void Stop() {
+            m_running = false;
+            if (m_listenFd >= 0) ::shutdown(m_listenFd, SHUT_RDWR);
+        }
+
+        /**
+         * Serves one connection until the web server closes it or a request
+         * without FCGI_KEEP_CONN has been answered.
+         */
+        void Serve(int fd) {
+            m_connection.Reset();
+            while (!m_connection.ShouldClose()) {
+                ssize_t got = ::read(fd, m_buffer.data(), m_buffer.size());
+                if (got < 0 && errno == EINTR) continue;
+                if (got <= 0) break;
+
+                bool ok = m_connection.Feed(m_buffer.data(), static_cast<std::size_t>(got));
+                if (!writeAll(fd, m_connection.Output()) || !ok) break;
+            }
+        }
+
+        Parser_T &Parser() {
+            return m_parser;
+        }
+
+    private:
+        Parser_T m_parser;
+        FastCgiConnection<Parser_T> m_connection;
+        std::vector<char> m_buffer;
+        int m_listenFd = -1;
+        // Only sockets opened by listenOn are closed, not those handed to Listen
+        bool m_ownsListenFd = false;
+        std::atomic<bool> m_running{ false };
+
+        bool listenOn(int family, const sockaddr *address, socklen_t length, int backlog) {
+            int fd = ::socket(family, SOCK_STREAM, 0);
+            if (fd < 0) return false;
+
+            int yes = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            if (::bind(fd, address, length) < 0 || ::listen(fd, backlog) < 0) {
+                ::close(fd);
+                return false;
+            }
+            closeListener();
+            m_listenFd = fd;
+            m_ownsListenFd = true;
+            return true;
+        }
+
+        void closeListener() {
+            if (m_listenFd >= 0 && m_ownsListenFd) ::close(m_listenFd);
+            m_listenFd = -1;
+            m_ownsListenFd = false;
+        }
+
+        // MSG_NOSIGNAL, so a web server that closed the connection is an error instead of a SIGPIPE
+        static bool writeAll(int fd, std::string &output) {
+            std::size_t written = 0;
+            while (written < output.size()) {
+                ssize_t n = ::send(fd, output.data() + written, output.size() - written, MSG_NOSIGNAL);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+                written += static_cast<std::size_t>(n);
+            }
+            output.clear();
+            return true;
+        }
+    };
+
+}
+
+#endif
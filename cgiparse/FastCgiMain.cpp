@@ -0,0 +1,158 @@
+#include <iostream>
+#include <chrono>
+#include "Cgiparse.hpp"
+#include "FastCgi.hpp"
+
+struct CgiArguments : public cgiparse::CgiInputParser<> {
+    uint16_t a;
+    int32_t d;
+    double m;
+    std::string b;
+    std::vector<int> o;
+    int64_t l = 30;
+
+    void Parse(cgiparse::Getter_t &getter) {
+        l = 30;
+        cgiInput(getter, a, "done");
+        cgiInput(getter, d, "d");
+        cgiInput(getter, m, "blah");
+        cgiInput(getter, b, "str");
+        cgiInput(getter, o, "lol");
+        cgiInputOptional(getter, l, "llll");
+    }
+};
+
+void handle(cgiparse::FastCgiRequest &request, CgiArguments &args) {
+    args.GetCgiArgs(request.Getter());
+
+    std::string &out = request.Out();
+    out += "Content-Type: text/plain\r\n\r\n";
+
+    if (args.HasErrors()) {
+        out += "cgi has errors\n";
+        for (const auto &error : args.getErrors()) {
+            out.append(error.key.data(), error.key.size());
+            out += "[" + std::to_string(error.index) + "]\n";
+        }
+        return;
+    }
+
+    out += "hello a: " + std::to_string(args.a) + "\n";
+    out += "hello d: " + std::to_string(args.d) + "\n";
+    out += "hello m: " + std::to_string(args.m) + "\n";
+    out += "hello str: " + args.b + "\n";
+    out += "hello llll: " + std::to_string(args.l) + "\n";
+}
+
+int connectTo(const std::string &where) {
+    int fd;
+    if (where.find('/') != std::string::npos) {
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, where.c_str(), sizeof(address.sun_path) - 1);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+            ::close(fd);
+            return -1;
+        }
+    } else {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(std::stoi(where)));
+        ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+            ::close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+// A stand-in for the web server side: sends `count` requests over one kept alive connection
+int request(const std::string &where, const std::string &query, std::size_t count) {
+    int fd = connectTo(where);
+    if (fd < 0) {
+        std::cerr << "could not connect to " << where << "\n";
+        return 1;
+    }
+
+    std::string params, message, reply, body;
+    std::vector<char> buffer(64 * 1024);
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < count; ++i) {
+        uint16_t id = static_cast<uint16_t>(i % 100 + 1);
+        const char begin[8] = { 0, cgiparse::fcgi::RESPONDER, cgiparse::fcgi::KEEP_CONN, 0, 0, 0, 0, 0 };
+
+        params.clear();
+        cgiparse::fcgi::AppendNameValue(params, "REQUEST_METHOD", "GET");
+        cgiparse::fcgi::AppendNameValue(params, "QUERY_STRING", query);
+
+        message.clear();
+        cgiparse::fcgi::AppendRecord(message, cgiparse::fcgi::BEGIN_REQUEST, id, begin, sizeof(begin));
+        cgiparse::fcgi::AppendStream(message, cgiparse::fcgi::PARAMS, id, params);
+        cgiparse::fcgi::AppendStream(message, cgiparse::fcgi::STDIN, id, "");
+        if (::send(fd, message.data(), message.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(message.size())) return 1;
+
+        bool ended = false;
+        reply.clear();
+        body.clear();
+        while (!ended) {
+            ssize_t got = ::read(fd, buffer.data(), buffer.size());
+            if (got <= 0) return 1;
+            reply.append(buffer.data(), static_cast<std::size_t>(got));
+
+            std::size_t pos = 0;
+            while (reply.size() - pos >= cgiparse::fcgi::HEADER_LEN) {
+                auto header = cgiparse::fcgi::ReadHeader(reply.data() + pos);
+                std::size_t length = cgiparse::fcgi::HEADER_LEN + header.contentLength + header.paddingLength;
+                if (reply.size() - pos < length) break;
+
+                if (header.type == cgiparse::fcgi::STDOUT) {
+                    body.append(reply, pos + cgiparse::fcgi::HEADER_LEN, header.contentLength);
+                } else if (header.type == cgiparse::fcgi::END_REQUEST) {
+                    ended = true;
+                }
+                pos += length;
+            }
+            reply.erase(0, pos);
+        }
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    ::close(fd);
+
+    std::cout << body;
+    std::cout << count << " requests, "
+              << std::chrono::duration<double, std::micro>(elapsed).count() / count << " us/request\n";
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " serve <socket path|port>\n"
+                  << "       " << argv[0] << " request <socket path|port> <query string> [count]\n";
+        return 1;
+    }
+
+    std::string mode = argv[1];
+    std::string where = argv[2];
+
+    if (mode == "request") {
+        return request(where, argc > 3 ? argv[3] : "", argc > 4 ? std::stoull(argv[4]) : 1);
+    }
+
+    cgiparse::FastCgiResponder<CgiArguments> responder(handle);
+    bool listening = where.find('/') != std::string::npos
+        ? responder.ListenUnix(where)
+        : responder.ListenTcp(static_cast<uint16_t>(std::stoi(where)));
+
+    if (!listening) {
+        std::cerr << "could not listen on " << where << "\n";
+        return 1;
+    }
+
+    responder.Run();
+    return 0;
+}
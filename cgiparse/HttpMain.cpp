@@ -0,0 +1,181 @@
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include "Cgiparse.hpp"
+#include "HttpServer.hpp"
+
+struct CgiArguments : public cgiparse::CgiInputParser<> {
+    uint16_t a;
+    int32_t d;
+    std::string b;
+    std::vector<int> o;
+
+    void Parse(cgiparse::Getter_t &getter) {
+        cgiInput(getter, a, "done");
+        cgiInput(getter, d, "d");
+        cgiInput(getter, b, "str");
+        cgiInput(getter, o, "lol");
+    }
+};
+
+void handle(cgiparse::HttpRequest &request, cgiparse::HttpResponse &response, CgiArguments &args) {
+    args.GetCgiArgs(request.Getter());
+    response.AddHeader("Content-Type", "text/plain");
+
+    if (args.HasErrors()) {
+        response.status = 400;
+        response.body = "cgi has errors\n";
+        return;
+    }
+    response.body = "hello " + args.b + " " + std::to_string(args.a + args.d) + "\n";
+}
+
+int connectTo(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    int yes = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    return fd;
+}
+
+// Reads one response from the front of buffer, returns its length or 0 if it is incomplete
+std::size_t responseLength(const std::string &buffer) {
+    std::size_t headerEnd = buffer.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) return 0;
+    std::size_t at = buffer.find("Content-Length: ");
+    std::size_t length = at < headerEnd ? std::stoull(buffer.substr(at + 16)) : 0;
+    return buffer.size() >= headerEnd + 4 + length ? headerEnd + 4 + length : 0;
+}
+
+/**
+ * Each client thread keeps one connection open and sends `pipeline` requests
+ * at a time. Latency is measured from sending a batch to reading each reply.
+ */
+int load(uint16_t port, std::size_t connections, std::size_t requests, std::size_t pipeline) {
+    const std::string request =
+        "GET /?done=12&d=30&str=load&lol=1,2,3 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+    std::vector<std::vector<double>> latencies(connections);
+    std::vector<std::thread> clients;
+    std::atomic<std::size_t> failures{ 0 };
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t c = 0; c < connections; ++c) {
+        clients.emplace_back([&, c]() {
+            int fd = connectTo(port);
+            if (fd < 0) {
+                ++failures;
+                return;
+            }
+
+            std::string batch, buffer;
+            std::vector<char> chunk(64 * 1024);
+            latencies[c].reserve(requests);
+
+            for (std::size_t sent = 0; sent < requests;) {
+                std::size_t count = std::min(pipeline, requests - sent);
+                batch.clear();
+                for (std::size_t i = 0; i < count; ++i) batch += request;
+
+                auto batchStart = std::chrono::steady_clock::now();
+                if (::send(fd, batch.data(), batch.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(batch.size())) {
+                    ++failures;
+                    break;
+                }
+
+                for (std::size_t received = 0; received < count;) {
+                    std::size_t length;
+                    while ((length = responseLength(buffer)) == 0) {
+                        ssize_t got = ::read(fd, chunk.data(), chunk.size());
+                        if (got <= 0) {
+                            ++failures;
+                            ::close(fd);
+                            return;
+                        }
+                        buffer.append(chunk.data(), static_cast<std::size_t>(got));
+                    }
+                    if (buffer.compare(0, 12, "HTTP/1.1 200") != 0) ++failures;
+                    buffer.erase(0, length);
+                    ++received;
+
+                    auto elapsed = std::chrono::steady_clock::now() - batchStart;
+                    latencies[c].push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+                }
+                sent += count;
+            }
+            ::close(fd);
+        });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for (const auto &l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    if (all.empty()) {
+        std::cerr << "no requests completed\n";
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+
+    std::cout << "requests:    " << all.size() << " (" << failures << " failures)\n";
+    std::cout << "requests/s:  " << all.size() / seconds << "\n";
+    std::cout << "p50 latency: " << all[all.size() / 2] << " us\n";
+    std::cout << "p99 latency: " << all[std::min(all.size() - 1, all.size() * 99 / 100)] << " us\n";
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "serve" && argc > 2) {
+        cgiparse::HttpServer<CgiArguments> server(handle, argc > 3 ? std::stoull(argv[3]) : std::thread::hardware_concurrency());
+        if (!server.Listen(static_cast<uint16_t>(std::stoi(argv[2])))) {
+            std::cerr << "could not listen on " << argv[2] << "\n";
+            return 1;
+        }
+        server.Run();
+        return 0;
+    }
+
+    if (mode == "load" && argc > 2) {
+        return load(static_cast<uint16_t>(std::stoi(argv[2])),
+                    argc > 3 ? std::stoull(argv[3]) : 8,
+                    argc > 4 ? std::stoull(argv[4]) : 10000,
+                    argc > 5 ? std::stoull(argv[5]) : 1);
+    }
+
+    if (mode == "selftest") {
+        uint16_t port = argc > 2 ? static_cast<uint16_t>(std::stoi(argv[2])) : 18080;
+        cgiparse::HttpServer<CgiArguments> server(handle, 2);
+        if (!server.Listen(port)) {
+            std::cerr << "could not listen on " << port << "\n";
+            return 1;
+        }
+        std::thread loop([&server]() { server.Run(); });
+
+        std::cout << "keep-alive, 8 connections:\n";
+        int result = load(port, 8, 5000, 1);
+        std::cout << "pipelined by 16, 8 connections:\n";
+        result |= load(port, 8, 5000, 16);
+
+        server.Stop();
+        loop.join();
+        return result;
+    }
+
+    std::cerr << "usage: " << argv[0] << " serve <port> [workers]\n"
+              << "       " << argv[0] << " load <port> [connections] [requests per connection] [pipeline depth]\n"
+              << "       " << argv[0] << " selftest [port]\n";
+    return 1;
+}
@@ -0,0 +1,525 @@
+#ifndef CGIPARSE_HTTPSERVER_H_c7wq2nfk58xapz0ejm3ld1v
+#define CGIPARSE_HTTPSERVER_H_c7wq2nfk58xapz0ejm3ld1v
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <functional>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "Cgiparse.hpp"
+#include "Urlencoded.hpp"
+
+namespace cgiparse {
+
+    /**
+     * A parsed HTTP/1.1 request. Every view points into the receive buffer of
+     * the connection and is only valid while the handler runs.
+     */
+    struct HttpRequest {
+        std::string_view method;
+        std::string_view target;
+        std::string_view path;
+        std::string_view query;
+        std::string_view body;
+        std::vector<std::pair<std::string_view, std::string_view>> headers;
+        bool keepAlive = true;
+
+        std::string_view Header(std::string_view name) const {
+            for (const auto &header : headers) {
+                if (header.first.size() == name.size() && ::strncasecmp(header.first.data(), name.data(), name.size()) == 0) {
+                    return header.second;
+                }
+            }
+            return std::string_view();
+        }
+
+        /**
+         * Getter over the decoded query string, or over the body for
+         * application/x-www-form-urlencoded requests.
+         */
+        cgiparse::Getter_t Getter() {
+            std::string_view contentType = Header("Content-Type");
+            if (contentType.compare(0, 33, "application/x-www-form-urlencoded") == 0) {
+                m_index->Parse(body);
+            } else {
+                m_index->Parse(query);
+            }
+            return m_index->Getter();
+        }
+
+    private:
+        template<typename Parser_T> friend class HttpServer;
+        QueryIndex *m_index = nullptr;
+    };
+
+    struct HttpResponse {
+        int status = 200;
+        std::string headers;
+        std::string body;
+
+        void AddHeader(std::string_view name, std::string_view value) {
+            headers.append(name.data(), name.size());
+            headers += ": ";
+            headers.append(value.data(), value.size());
+            headers += "\r\n";
+        }
+
+        void reset() {
+            status = 200;
+            headers.clear();
+            body.clear();
+        }
+    };
+
+    enum class HttpParseResult {
+        OK = 0,
+        INCOMPLETE,
+        BAD_REQUEST,
+        HEADER_TOO_LARGE,
+        BODY_TOO_LARGE,
+        NOT_IMPLEMENTED
+    };
+
+    /**
+     * Parses one request from the front of data without copying. On OK,
+     * length is the number of bytes the request occupies.
+     */
+    inline HttpParseResult ParseHttpRequest(std::string_view data, HttpRequest &request, std::size_t &length,
+                                            std::size_t maxHeaderSize = 16 * 1024, std::size_t maxBodySize = 8 * 1024 * 1024) {
+        std::size_t headerEnd = data.find("\r\n\r\n");
+        if (headerEnd == std::string_view::npos) {
+            return data.size() > maxHeaderSize ? HttpParseResult::HEADER_TOO_LARGE : HttpParseResult::INCOMPLETE;
+        }
+        if (headerEnd > maxHeaderSize) return HttpParseResult::HEADER_TOO_LARGE;
+
+        std::string_view head = data.substr(0, headerEnd);
+        std::size_t lineEnd = head.find("\r\n");
+        std::string_view line = head.substr(0, lineEnd);
+        head = lineEnd == std::string_view::npos ? std::string_view() : head.substr(lineEnd + 2);
+
+        std::size_t space1 = line.find(' ');
+        std::size_t space2 = space1 == std::string_view::npos ? space1 : line.find(' ', space1 + 1);
+        if (space2 == std::string_view::npos) return HttpParseResult::BAD_REQUEST;
+
+        request.method = line.substr(0, space1);
+        request.target = line.substr(space1 + 1, space2 - space1 - 1);
+        std::string_view version = line.substr(space2 + 1);
+        if (version != "HTTP/1.1" && version != "HTTP/1.0") return HttpParseResult::BAD_REQUEST;
+
+        std::size_t question = request.target.find('?');
+        request.path = request.target.substr(0, question);
+        request.query = question == std::string_view::npos ? std::string_view() : request.target.substr(question + 1);
+
+        request.headers.clear();
+        request.keepAlive = version == "HTTP/1.1";
+        std::size_t contentLength = 0;
+
+        while (!head.empty()) {
+            lineEnd = head.find("\r\n");
+            line = head.substr(0, lineEnd);
+            head = lineEnd == std::string_view::npos ? std::string_view() : head.substr(lineEnd + 2);
+
+            std::size_t colon = line.find(':');
+            if (colon == std::string_view::npos) return HttpParseResult::BAD_REQUEST;
+
+            std::string_view name = line.substr(0, colon);
+            std::string_view value = line.substr(colon + 1);
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            request.headers.emplace_back(name, value);
+
+            if (name.size() == 14 && ::strncasecmp(name.data(), "Content-Length", 14) == 0) {
+                contentLength = 0;
+                for (char c : value) {
+                    if (c < '0' || c > '9') return HttpParseResult::BAD_REQUEST;
+                    contentLength = contentLength * 10 + static_cast<std::size_t>(c - '0');
+                    if (contentLength > maxBodySize) return HttpParseResult::BODY_TOO_LARGE;
+                }
+            } else if (name.size() == 17 && ::strncasecmp(name.data(), "Transfer-Encoding", 17) == 0) {
+                return HttpParseResult::NOT_IMPLEMENTED;
+            } else if (name.size() == 10 && ::strncasecmp(name.data(), "Connection", 10) == 0) {
+                if (value.size() == 5 && ::strncasecmp(value.data(), "close", 5) == 0) request.keepAlive = false;
+                if (value.size() == 10 && ::strncasecmp(value.data(), "keep-alive", 10) == 0) request.keepAlive = true;
+            }
+        }
+
+        std::size_t bodyStart = headerEnd + 4;
+        if (data.size() - bodyStart < contentLength) return HttpParseResult::INCOMPLETE;
+
+        request.body = data.substr(bodyStart, contentLength);
+        length = bodyStart + contentLength;
+        return HttpParseResult::OK;
+    }
+
+    inline const char *HttpReason(int status) {
+        switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 204: return "No Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+        }
+    }
+
+    /**
+     * Single binary HTTP/1.1 front end for CgiInputParser handlers. One thread
+     * runs the epoll loop and does all socket I/O, a pool of workers runs the
+     * handlers, each with its own Parser_T. A connection is handed to one
+     * worker at a time, which answers every complete pipelined request in its
+     * buffer in order, so responses go out in one write per batch.
+     */
+    template<typename Parser_T>
+    class HttpServer {
+        struct Connection {
+            int fd;
+            std::string input;
+            std::size_t consumed = 0;
+            std::string output;
+            std::size_t written = 0;
+            bool busy = false;
+            bool closing = false;
+            bool peerClosed = false;
+        };
+
+    public:
+        using Handler_t = std::function<void (HttpRequest &request, HttpResponse &response, Parser_T &parser)>;
+
+        explicit HttpServer(Handler_t handler, std::size_t workers = std::thread::hardware_concurrency())
+            : m_handler(std::move(handler))
+            , m_workerCount(workers == 0 ? 1 : workers) {}
+
+        ~HttpServer() {
+            Stop();
+            for (auto &worker : m_workers) {
+                if (worker.joinable()) worker.join();
+            }
+            if (m_listenFd >= 0) ::close(m_listenFd);
+            if (m_wakeFd >= 0) ::close(m_wakeFd);
+            if (m_epollFd >= 0) ::close(m_epollFd);
+        }
+
+        HttpServer(const HttpServer &) = delete;
+        HttpServer &operator=(const HttpServer &) = delete;
+
+        bool Listen(std::uint16_t port, const std::string &host = "127.0.0.1", int backlog = 1024) {
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            if (::inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) return false;
+
+            m_listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (m_listenFd < 0) return false;
+
+            int yes = 1;
+            ::setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            if (::bind(m_listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) return false;
+            if (::listen(m_listenFd, backlog) < 0) return false;
+
+            m_epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+            m_wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (m_epollFd < 0 || m_wakeFd < 0) return false;
+
+            control(EPOLL_CTL_ADD, m_listenFd, EPOLLIN);
+            control(EPOLL_CTL_ADD, m_wakeFd, EPOLLIN);
+            return true;
+        }
+
+        /**
+         * Runs the event loop on the calling thread until Stop is called. A
+         * Stop that comes first makes Run return at once, so a server runs once.
+         */
+        void Run() {
+            for (std::size_t i = 0; i < m_workerCount; ++i) {
+                m_workers.emplace_back([this]() { work(); });
+            }
+
+            std::vector<epoll_event> events(256);
+            while (m_running) {
+                int count = ::epoll_wait(m_epollFd, events.data(), static_cast<int>(events.size()), -1);
+                if (count < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+
+                for (int i = 0; i < count; ++i) {
+                    int fd = events[i].data.fd;
+                    if (fd == m_listenFd) {
+                        acceptAll();
+                    } else if (fd == m_wakeFd) {
+                        completeAll();
+                    } else {
+                        auto it = m_connections.find(fd);
+                        if (it != m_connections.end()) onEvent(*it->second, events[i].events);
+                    }
+                }
+            }
+
+            m_running = false;
+            m_jobsChanged.notify_all();
+            for (auto &worker : m_workers) {
+                if (worker.joinable()) worker.join();
+            }
+            m_workers.clear();
+            for (auto &connection : m_connections) {
+                ::close(connection.first);
+            }
+            m_connections.clear();
+        }
+
+        /**
+         * Can be called from any thread.
+         */
+        void Stop() {
+            if (!m_running.exchange(false)) return;
+            m_jobsChanged.notify_all();
+            wake();
+        }
+
+    private:
+        Handler_t m_handler;
+        std::size_t m_workerCount;
+        std::vector<std::thread> m_workers;
+        // Starts out true so a Stop before Run is not lost
+        std::atomic<bool> m_running{ true };
+
+        int m_listenFd = -1;
+        int m_epollFd = -1;
+        int m_wakeFd = -1;
+        std::unordered_map<int, std::unique_ptr<Connection>> m_connections;
+
+        std::mutex m_jobsMutex;
+        std::condition_variable m_jobsChanged;
+        std::deque<Connection *> m_jobs;
+
+        std::mutex m_doneMutex;
+        std::vector<Connection *> m_done;
+        std::vector<Connection *> m_doneSwap;
+
+        void control(int operation, int fd, std::uint32_t events) {
+            epoll_event event = {};
+            event.events = events;
+            event.data.fd = fd;
+            ::epoll_ctl(m_epollFd, operation, fd, &event);
+        }
+
+        void wake() {
+            std::uint64_t one = 1;
+            ssize_t ignored = ::write(m_wakeFd, &one, sizeof(one));
+            (void)ignored;
+        }
+
+        void acceptAll() {
+            while (true) {
+                int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) return;
+
+                int yes = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+                auto connection = std::make_unique<Connection>();
+                connection->fd = fd;
+                m_connections.emplace(fd, std::move(connection));
+                control(EPOLL_CTL_ADD, fd, EPOLLIN | EPOLLONESHOT);
+            }
+        }
+
+        void closeConnection(Connection &connection) {
+            int fd = connection.fd;
+            ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            ::close(fd);
+            m_connections.erase(fd);
+        }
+
+        void onEvent(Connection &connection, std::uint32_t events) {
+            if (connection.busy) return;
+
+            if (events & EPOLLOUT) {
+                flush(connection);
+                return;
+            }
+            if (events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(connection);
+                return;
+            }
+
+            char buffer[64 * 1024];
+            while (true) {
+                ssize_t got = ::read(connection.fd, buffer, sizeof(buffer));
+                if (got > 0) {
+                    connection.input.append(buffer, static_cast<std::size_t>(got));
+                    continue;
+                }
+                if (got == 0) connection.peerClosed = true;
+                else if (errno == EINTR) continue;
+                else if (errno != EAGAIN && errno != EWOULDBLOCK) connection.peerClosed = true;
+                break;
+            }
+
+            // Wait for the rest of the head before bothering a worker
+            bool headComplete = connection.input.find("\r\n\r\n") != std::string::npos || connection.input.size() > 16 * 1024;
+            if (connection.input.empty() || (!headComplete && !connection.peerClosed)) {
+                if (connection.peerClosed) {
+                    closeConnection(connection);
+                } else {
+                    control(EPOLL_CTL_MOD, connection.fd, EPOLLIN | EPOLLONESHOT);
+                }
+                return;
+            }
+
+            // The worker owns the connection until it reports back. It stays disarmed meanwhile,
+            // an empty event mask would still report EPOLLHUP and EPOLLERR on every wait
+            connection.busy = true;
+            {
+                std::lock_guard<std::mutex> lock(m_jobsMutex);
+                m_jobs.push_back(&connection);
+            }
+            m_jobsChanged.notify_one();
+        }
+
+        void completeAll() {
+            std::uint64_t value;
+            while (::read(m_wakeFd, &value, sizeof(value)) > 0) {}
+
+            {
+                std::lock_guard<std::mutex> lock(m_doneMutex);
+                m_doneSwap.swap(m_done);
+            }
+            for (Connection *connection : m_doneSwap) {
+                connection->busy = false;
+                connection->input.erase(0, connection->consumed);
+                connection->consumed = 0;
+                flush(*connection);
+            }
+            m_doneSwap.clear();
+        }
+
+        void flush(Connection &connection) {
+            while (connection.written < connection.output.size()) {
+                ssize_t n = ::send(connection.fd, connection.output.data() + connection.written,
+                                   connection.output.size() - connection.written, MSG_NOSIGNAL);
+                if (n > 0) {
+                    connection.written += static_cast<std::size_t>(n);
+                    continue;
+                }
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    control(EPOLL_CTL_MOD, connection.fd, EPOLLOUT | EPOLLONESHOT);
+                    return;
+                }
+                closeConnection(connection);
+                return;
+            }
+
+            connection.output.clear();
+            connection.written = 0;
+            if (connection.closing || connection.peerClosed) {
+                closeConnection(connection);
+            } else {
+                control(EPOLL_CTL_MOD, connection.fd, EPOLLIN | EPOLLONESHOT);
+            }
+        }
+
+        void work() {
+            Parser_T parser;
+            QueryIndex index;
+            HttpRequest request;
+            HttpResponse response;
+            request.m_index = &index;
+
+            while (true) {
+                Connection *connection;
+                {
+                    std::unique_lock<std::mutex> lock(m_jobsMutex);
+                    m_jobsChanged.wait(lock, [this]() { return !m_jobs.empty() || !m_running; });
+                    if (!m_running) return;
+                    connection = m_jobs.front();
+                    m_jobs.pop_front();
+                }
+
+                answerAll(*connection, parser, request, response);
+
+                {
+                    std::lock_guard<std::mutex> lock(m_doneMutex);
+                    m_done.push_back(connection);
+                }
+                wake();
+            }
+        }
+
+        void answerAll(Connection &connection, Parser_T &parser, HttpRequest &request, HttpResponse &response) {
+            while (!connection.closing) {
+                std::string_view pending = std::string_view(connection.input).substr(connection.consumed);
+                std::size_t length = 0;
+                HttpParseResult result = ParseHttpRequest(pending, request, length);
+                if (result == HttpParseResult::INCOMPLETE) break;
+
+                response.reset();
+                if (result == HttpParseResult::OK) {
+                    try {
+                        m_handler(request, response, parser);
+                    } catch (const std::exception &) {
+                        response.reset();
+                        response.status = 500;
+                    }
+                    connection.consumed += length;
+                    connection.closing = !request.keepAlive;
+                } else {
+                    response.status = result == HttpParseResult::HEADER_TOO_LARGE ? 431
+                        : result == HttpParseResult::BODY_TOO_LARGE ? 413
+                        : result == HttpParseResult::NOT_IMPLEMENTED ? 501 : 400;
+                    connection.closing = true;
+                }
+                serialize(connection.output, response, connection.closing);
+            }
+        }
+
+        static void serialize(std::string &output, const HttpResponse &response, bool closing) {
+            output += "HTTP/1.1 ";
+            output += std::to_string(response.status);
+            output += ' ';
+            output += HttpReason(response.status);
+            output += "\r\nContent-Length: ";
+            output += std::to_string(response.body.size());
+            output += "\r\n";
+            if (closing) output += "Connection: close\r\n";
+            output += response.headers;
+            output += "\r\n";
+            output += response.body;
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef CGIPARSE_LOGREPLAY_H_r6vb1xk3ma9zqe04pldn7hw
+#define CGIPARSE_LOGREPLAY_H_r6vb1xk3ma9zqe04pldn7hw
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <array>
+#include <thread>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Cgiparse.hpp"
+#include "Urlencoded.hpp"
+
+namespace cgiparse {
+
+    /**
+     * A read only memory mapping of a whole file.
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string &path) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+
+            struct stat info;
+            if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+                void *data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED) {
+                    ::madvise(data, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+                    m_data = static_cast<const char *>(data);
+                    m_size = static_cast<std::size_t>(info.st_size);
+                }
+            }
+            ::close(fd);
+        }
+
+        ~MappedFile() {
+            if (m_data) ::munmap(const_cast<char *>(m_data), m_size);
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        bool IsOpen() const {
+            return m_data != nullptr;
+        }
+
+        std::string_view View() const {
+            return std::string_view(m_data, m_size);
+        }
+
+    private:
+        const char *m_data = nullptr;
+        std::size_t m_size = 0;
+    };
+
+    /**
+     * Extracts the query string from a common/combined log format line, i.e.
+     * from the target of the quoted request line. Returns false for lines
+     * without a request line.
+     */
+    inline bool QueryFromLogLine(std::string_view line, std::string_view &query) {
+        std::size_t quote = line.find('"');
+        if (quote == std::string_view::npos) return false;
+
+        std::size_t targetStart = line.find(' ', quote + 1);
+        if (targetStart == std::string_view::npos) return false;
+        ++targetStart;
+
+        std::size_t targetEnd = line.find_first_of(" \"", targetStart);
+        if (targetEnd == std::string_view::npos) targetEnd = line.size();
+
+        std::string_view target = line.substr(targetStart, targetEnd - targetStart);
+        std::size_t question = target.find('?');
+        query = question == std::string_view::npos ? std::string_view() : target.substr(question + 1);
+        return true;
+    }
+
+    struct ReplayFieldStats {
+        std::size_t calls = 0;
+        std::uint64_t nanoseconds = 0;
+        std::array<std::size_t, 4> errors{};
+    };
+
+    struct ReplayStats {
+        std::size_t requests = 0;
+        std::size_t requestsWithErrors = 0;
+        std::size_t bytes = 0;
+        double seconds = 0;
+        std::array<std::size_t, 4> errors{};
+        std::unordered_map<std::string, ReplayFieldStats> fields;
+
+        void merge(const ReplayStats &other) {
+            requests += other.requests;
+            requestsWithErrors += other.requestsWithErrors;
+            bytes += other.bytes;
+            for (std::size_t i = 0; i < errors.size(); ++i) {
+                errors[i] += other.errors[i];
+            }
+            for (const auto &field : other.fields) {
+                ReplayFieldStats &into = fields[field.first];
+                into.calls += field.second.calls;
+                into.nanoseconds += field.second.nanoseconds;
+                for (std::size_t i = 0; i < into.errors.size(); ++i) {
+                    into.errors[i] += field.second.errors[i];
+                }
+            }
+        }
+
+        void Report(std::ostream &out) const {
+            out << "requests:          " << requests << "\n";
+            out << "with errors:       " << requestsWithErrors << "\n";
+            out << "time:              " << seconds << " s\n";
+            out << "requests/s:        " << (seconds > 0 ? requests / seconds : 0) << "\n";
+            out << "MB/s:              " << (seconds > 0 ? bytes / seconds / (1024 * 1024) : 0) << "\n";
+
+            out << "errors by type:\n";
+            for (std::size_t i = 1; i < errors.size(); ++i) {
+                out << "  " << std::left << std::setw(17) << ToString(static_cast<CgiInputErrorTypes>(i)) << errors[i] << "\n";
+            }
+
+            if (fields.empty()) return;
+
+            std::vector<const std::pair<const std::string, ReplayFieldStats> *> sorted;
+            for (const auto &field : fields) {
+                sorted.push_back(&field);
+            }
+            std::sort(sorted.begin(), sorted.end(), [](const auto *a, const auto *b) {
+                return a->second.nanoseconds > b->second.nanoseconds;
+            });
+
+            out << "fields (calls, ns/call, missing/invalid/out of range):\n";
+            for (const auto *field : sorted) {
+                const ReplayFieldStats &stats = field->second;
+                out << "  " << std::left << std::setw(16) << field->first
+                    << std::right << std::setw(10) << stats.calls
+                    << std::setw(10) << std::fixed << std::setprecision(1)
+                    << (stats.calls ? static_cast<double>(stats.nanoseconds) / stats.calls : 0.0)
+                    << std::defaultfloat
+                    << std::setw(8) << stats.errors[1] << std::setw(8) << stats.errors[2] << std::setw(8) << stats.errors[3] << "\n";
+            }
+        }
+    };
+
+    /**
+     * Replays the query strings of an access log through a parser on several
+     * threads. Every thread has its own Parser_T and its own QueryIndex, which
+     * keeps the decoded strings between requests, so threads share nothing
+     * but the read only mapping.
+     *
+     * With profileFields, the getter handed to the parser marks where each
+     * field starts, and the time until the next field (or the end of Parse)
+     * is booked on that field.
+     */
+    template<typename Parser_T>
+    class LogReplay {
+    public:
+        explicit LogReplay(std::size_t threads = std::thread::hardware_concurrency(), bool profileFields = false)
+            : m_threads(threads == 0 ? 1 : threads)
+            , m_profileFields(profileFields) {}
+
+        ReplayStats Run(std::string_view log) {
+            std::vector<std::string_view> slices = split(log);
+            std::vector<ReplayStats> stats(slices.size());
+            std::vector<std::thread> workers;
+
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < slices.size(); ++i) {
+                workers.emplace_back([this, &slices, &stats, i]() {
+                    replay(slices[i], stats[i]);
+                });
+            }
+            for (auto &worker : workers) {
+                worker.join();
+            }
+
+            ReplayStats total;
+            for (const auto &partial : stats) {
+                total.merge(partial);
+            }
+            total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return total;
+        }
+
+    private:
+        std::size_t m_threads;
+        bool m_profileFields;
+
+        // Cuts the log into one slice per thread at line boundaries
+        std::vector<std::string_view> split(std::string_view log) const {
+            std::vector<std::string_view> slices;
+            std::size_t chunk = log.size() / m_threads + 1;
+            std::size_t at = 0;
+            while (at < log.size()) {
+                std::size_t end = std::min(log.size(), at + chunk);
+                std::size_t newline = log.find('\n', end);
+                end = newline == std::string_view::npos ? log.size() : newline + 1;
+                slices.push_back(log.substr(at, end - at));
+                at = end;
+            }
+            return slices;
+        }
+
+        void replay(std::string_view slice, ReplayStats &stats) const {
+            using Clock = std::chrono::steady_clock;
+
+            Parser_T parser;
+            QueryIndex index;
+
+            ReplayFieldStats *current = nullptr;
+            Clock::time_point currentStart;
+            auto closeField = [&current, &currentStart](Clock::time_point now) {
+                if (current) {
+                    current->nanoseconds += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - currentStart).count());
+                    current = nullptr;
+                }
+            };
+
+            cgiparse::Getter_t getter = index.Getter();
+            cgiparse::Getter_t profilingGetter = [&](const std::string &key) {
+                Clock::time_point now = Clock::now();
+                closeField(now);
+                current = &stats.fields[key];
+                ++current->calls;
+                currentStart = now;
+
+                const std::string *value = index.Find(key);
+                return value ? *value : std::string();
+            };
+
+            while (!slice.empty()) {
+                std::size_t newline = slice.find('\n');
+                std::string_view line = slice.substr(0, newline);
+                slice = newline == std::string_view::npos ? std::string_view() : slice.substr(newline + 1);
+
+                std::string_view query;
+                if (!QueryFromLogLine(line, query)) continue;
+
+                ++stats.requests;
+                stats.bytes += query.size();
+                index.Parse(query);
+
+                if (m_profileFields) {
+                    parser.GetCgiArgs(profilingGetter);
+                    closeField(Clock::now());
+                } else {
+                    parser.GetCgiArgs(getter);
+                }
+
+                if (!parser.HasErrors()) continue;
+                ++stats.requestsWithErrors;
+                for (const auto &error : parser.getErrors()) {
+                    std::size_t type = static_cast<std::size_t>(error.type);
+                    ++stats.errors[type];
+                    if (m_profileFields) {
+                        ++stats.fields[std::string(error.key)].errors[type];
+                    }
+                }
+            }
+        }
+    };
+
+}
+
+#endif
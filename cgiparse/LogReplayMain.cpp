@@ -0,0 +1,53 @@
+#include <iostream>
+#include "Cgiparse.hpp"
+#include "LogReplay.hpp"
+
+struct CgiArguments : public cgiparse::CgiInputParser<> {
+    uint16_t a;
+    int32_t d;
+    double m;
+    std::string b;
+    std::vector<int> o;
+    int64_t l = 30;
+
+    void Parse(cgiparse::Getter_t &getter) {
+        l = 30;
+        cgiInput(getter, a, "done");
+        cgiInput(getter, d, "d");
+        cgiInput(getter, m, "blah");
+        cgiInput(getter, b, "str");
+        cgiInput(getter, o, "lol");
+        cgiInputOptional(getter, l, "llll");
+    }
+};
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <access log> [threads] [--fields]\n";
+        return 1;
+    }
+
+    std::size_t threads = std::thread::hardware_concurrency();
+    bool profileFields = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--fields") {
+            profileFields = true;
+        } else {
+            threads = std::stoull(arg);
+        }
+    }
+
+    cgiparse::MappedFile log(argv[1]);
+    if (!log.IsOpen()) {
+        std::cerr << "could not map " << argv[1] << "\n";
+        return 1;
+    }
+
+    cgiparse::LogReplay<CgiArguments> replay(threads, profileFields);
+    cgiparse::ReplayStats stats = replay.Run(log.View());
+
+    std::cout << "threads:           " << threads << "\n";
+    stats.Report(std::cout);
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include <iostream>
 #include "Cgiparse.hpp"
+#include "ResponseWriter.hpp"
 
 std::string getter(const std::string &key) {
     if (key == "done") {
@@ -50,31 +51,30 @@ int main(int argc, char **argv) {
     CgiArguments args;
     args.GetCgiArgs(getter);
 
+    cgiparse::ResponseWriter response;
+
     if (args.HasErrors()) {
-        std::cout << "cgi has errors" << std::endl;
+        response.Status(400, "Bad Request");
 
-        auto errors = args.getErrors();
-        for (auto error : errors) {
-            std::cout << error.first << "<->" << std::endl;
+        auto json = response.Json();
+        json.BeginObject().Key("errors").BeginArray();
+        for (auto error : args.getErrors()) {
+            json.BeginObject().Field("key", error.key).Field("index", error.index).EndObject();
         }
+        json.EndArray().EndObject();
     } else {
-        std::cout << "hello a: " << args.a << "\n";
-        std::cout << "hello c: " << args.c << "\n";
-        std::cout << "hello d: " << args.d << "\n";
-        std::cout << "hello m: " << args.m << "\n";
-        std::cout << "hello llll: " << args.l << "\n";
-
-        std::cout << "From o:\n";
-        for (const auto &l : args.o) {
-            std::cout << l << "\n";
-        }
-
-        std::cout << "From o:\n";
-        for (const auto &l : args.fs) {
-            std::cout << l << "\n";
-        }
+        response.Json()
+            .BeginObject()
+            .Field("a", args.a)
+            .Field("c", args.c)
+            .Field("d", args.d)
+            .Field("m", args.m)
+            .Field("str", args.b)
+            .Field("llll", args.l)
+            .Field("o", args.o)
+            .Field("fs", args.fs)
+            .EndObject();
     }
 
-    return 0;
+    return response.Flush() ? 0 : 1;
 }
-
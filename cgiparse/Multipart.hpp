@@ -0,0 +1,384 @@
+#ifndef CGIPARSE_MULTIPART_H_ql3kd9aopwe8123mdn4kfa0
+#define CGIPARSE_MULTIPART_H_ql3kd9aopwe8123mdn4kfa0
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <istream>
+#include "Cgiparse.hpp"
+
+namespace cgiparse {
+
+    enum class MultipartStatus {
+        OK = 0,
+        INCOMPLETE,
+        MALFORMED,
+        HEADER_TOO_LARGE,
+        FIELD_TOO_LARGE,
+        READ_ERROR
+    };
+
+    struct MultipartPart {
+        std::string name;
+        std::string filename;
+        std::string contentType;
+    };
+
+    /**
+     * Receives the contents of file parts (parts with a filename) as they are
+     * found in the body. Write can be called any number of times per part.
+     */
+    struct MultipartFileSink {
+        virtual ~MultipartFileSink() = default;
+        virtual void Begin(const MultipartPart &part) = 0;
+        virtual void Write(const MultipartPart &part, const char *data, std::size_t size) = 0;
+        virtual void End(const MultipartPart &part) = 0;
+    };
+
+    /**
+     * Boyer-Moore-Horspool search for a fixed needle.
+     */
+    class BoundarySearcher {
+    public:
+        void Reset(const std::string &needle) {
+            m_needle = needle;
+            for (std::size_t i = 0; i < 256; ++i) {
+                m_skip[i] = m_needle.size();
+            }
+            for (std::size_t i = 0; i + 1 < m_needle.size(); ++i) {
+                m_skip[static_cast<unsigned char>(m_needle[i])] = m_needle.size() - 1 - i;
+            }
+        }
+
+        std::size_t Find(const char *haystack, std::size_t size) const {
+            const std::size_t n = m_needle.size();
+            if (n == 0 || size < n) return std::string::npos;
+
+            const char last = m_needle[n - 1];
+            std::size_t i = 0;
+            while (i <= size - n) {
+                char c = haystack[i + n - 1];
+                if (c == last && std::memcmp(haystack + i, m_needle.data(), n - 1) == 0) {
+                    return i;
+                }
+                i += m_skip[static_cast<unsigned char>(c)];
+            }
+            return std::string::npos;
+        }
+
+        std::size_t size() const {
+            return m_needle.size();
+        }
+
+    private:
+        std::string m_needle;
+        std::size_t m_skip[256];
+    };
+
+    /**
+     * Streaming multipart/form-data parser with a fixed size working buffer.
+     * Small fields are collected into a key/value index that backs a Getter_t,
+     * so the result can be handed straight to a CgiInputParser. File parts are
+     * streamed to the MultipartFileSink and never buffered as a whole.
+     * Repeated field names are joined with ',' to match the list inputs.
+     */
+    class MultipartParser {
+        enum class State {
+            BODY,
+            AFTER_BOUNDARY,
+            HEADERS,
+            DONE,
+            FAILED
+        };
+    public:
+        explicit MultipartParser(std::size_t chunkSize = 64 * 1024, std::size_t maxFieldBytes = 1024 * 1024)
+            : m_buffer(chunkSize < s_maxHeaderSize * 2 ? s_maxHeaderSize * 2 : chunkSize)
+            , m_maxFieldBytes(maxFieldBytes) {}
+
+        /**
+         * Extracts the boundary parameter of a multipart/form-data CONTENT_TYPE.
+         */
+        static bool BoundaryFromContentType(const std::string &contentType, std::string &boundary) {
+            std::size_t at = contentType.find("boundary=");
+            if (at == std::string::npos) return false;
+            at += 9;
+
+            if (at < contentType.size() && contentType[at] == '"') {
+                std::size_t end = contentType.find('"', at + 1);
+                if (end == std::string::npos) return false;
+                boundary = contentType.substr(at + 1, end - at - 1);
+            } else {
+                std::size_t end = contentType.find_first_of("; \t", at);
+                boundary = contentType.substr(at, end == std::string::npos ? std::string::npos : end - at);
+            }
+            return !boundary.empty() && boundary.size() <= 70;
+        }
+
+        void Begin(const std::string &boundary, MultipartFileSink *sink = nullptr) {
+            m_searcher.Reset("\r\n--" + boundary);
+            m_sink = sink;
+            m_fields.clear();
+            m_fieldBytes = 0;
+            m_status = MultipartStatus::INCOMPLETE;
+            m_state = State::BODY;
+            m_inPart = false;
+
+            // The first boundary is not preceded by a line break, pretend it is
+            m_buffer[0] = '\r';
+            m_buffer[1] = '\n';
+            m_length = 2;
+        }
+
+        /**
+         * Pushes a piece of the body through the parser.
+         */
+        MultipartStatus Feed(const char *data, std::size_t size) {
+            while (size > 0 && !finished()) {
+                std::size_t n = std::min(size, m_buffer.size() - m_length);
+                std::memcpy(m_buffer.data() + m_length, data, n);
+                m_length += n;
+                data += n;
+                size -= n;
+                process();
+            }
+            return m_status;
+        }
+
+        /**
+         * Reads up to contentLength bytes from the stream in chunks directly
+         * into the working buffer, e.g. ParseStream(std::cin, CONTENT_LENGTH).
+         */
+        MultipartStatus ParseStream(std::istream &in, std::size_t contentLength = std::string::npos) {
+            while (contentLength > 0 && !finished()) {
+                std::size_t want = std::min(contentLength, m_buffer.size() - m_length);
+                in.read(m_buffer.data() + m_length, want);
+                std::size_t got = static_cast<std::size_t>(in.gcount());
+                if (got == 0) break;
+
+                m_length += got;
+                if (contentLength != std::string::npos) contentLength -= got;
+                process();
+            }
+
+            if (!finished()) {
+                fail(in.bad() ? MultipartStatus::READ_ERROR : MultipartStatus::INCOMPLETE);
+            }
+            return m_status;
+        }
+
+        MultipartStatus Status() const {
+            return m_status;
+        }
+
+        const std::map<std::string, std::string> &getFields() const {
+            return m_fields;
+        }
+
+        cgiparse::Getter_t Getter() const {
+            return [this](const std::string &key) {
+                auto it = m_fields.find(key);
+                return it == m_fields.end() ? std::string() : it->second;
+            };
+        }
+
+    private:
+        static const std::size_t s_maxHeaderSize = 8 * 1024;
+
+        std::vector<char> m_buffer;
+        std::size_t m_length = 0;
+        BoundarySearcher m_searcher;
+        MultipartFileSink *m_sink = nullptr;
+
+        State m_state = State::DONE;
+        MultipartStatus m_status = MultipartStatus::INCOMPLETE;
+
+        bool m_inPart = false;
+        MultipartPart m_part;
+        std::string *m_fieldValue = nullptr;
+
+        std::map<std::string, std::string> m_fields;
+        std::size_t m_fieldBytes = 0;
+        std::size_t m_maxFieldBytes;
+
+        bool finished() const {
+            return m_state == State::DONE || m_state == State::FAILED;
+        }
+
+        void fail(MultipartStatus status) {
+            m_state = State::FAILED;
+            m_status = status;
+            m_length = 0;
+        }
+
+        void process() {
+            const char *buffer = m_buffer.data();
+            std::size_t pos = 0;
+
+            while (!finished()) {
+                std::size_t available = m_length - pos;
+
+                if (m_state == State::BODY) {
+                    std::size_t found = m_searcher.Find(buffer + pos, available);
+                    if (found == std::string::npos) {
+                        // Keep a tail that could hold the start of a boundary
+                        std::size_t keep = std::min(available, m_searcher.size() - 1);
+                        if (!emit(buffer + pos, available - keep)) return;
+                        pos += available - keep;
+                        break;
+                    }
+                    if (!emit(buffer + pos, found)) return;
+                    endPart();
+                    pos += found + m_searcher.size();
+                    m_state = State::AFTER_BOUNDARY;
+                } else if (m_state == State::AFTER_BOUNDARY) {
+                    if (available < 2) break;
+                    if (buffer[pos] == '-' && buffer[pos + 1] == '-') {
+                        m_state = State::DONE;
+                        m_status = MultipartStatus::OK;
+                        m_length = 0;
+                        return;
+                    }
+                    std::size_t eol = findLineEnd(buffer + pos, available);
+                    if (eol == std::string::npos) {
+                        if (available > s_maxHeaderSize) return fail(MultipartStatus::MALFORMED);
+                        break;
+                    }
+                    // Skip transport padding after the boundary, the line break opens the headers
+                    pos += eol;
+                    m_state = State::HEADERS;
+                } else {
+                    std::size_t end = findHeaderEnd(buffer + pos, available);
+                    if (end == std::string::npos) {
+                        if (available > s_maxHeaderSize) return fail(MultipartStatus::HEADER_TOO_LARGE);
+                        break;
+                    }
+                    if (!beginPart(buffer + pos + 2, end < 2 ? 0 : end - 2)) return;
+                    pos += end + 4;
+                    m_state = State::BODY;
+                }
+            }
+
+            if (finished()) return;
+            std::memmove(m_buffer.data(), buffer + pos, m_length - pos);
+            m_length -= pos;
+        }
+
+        static std::size_t findLineEnd(const char *data, std::size_t size) {
+            for (std::size_t i = 0; i + 1 < size; ++i) {
+                if (data[i] == '\r' && data[i + 1] == '\n') return i;
+            }
+            return std::string::npos;
+        }
+
+        static std::size_t findHeaderEnd(const char *data, std::size_t size) {
+            for (std::size_t i = 0; i + 3 < size; ++i) {
+                if (data[i] == '\r' && data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n') return i;
+            }
+            return std::string::npos;
+        }
+
+        static std::string headerParameter(const std::string &header, const char *name) {
+            std::string key = std::string(name) + "=";
+            std::size_t at = 0;
+            while ((at = header.find(key, at)) != std::string::npos) {
+                // Make sure that we matched a whole parameter name, so name= does not hit filename=
+                if (at == 0 || header[at - 1] == ' ' || header[at - 1] == ';' || header[at - 1] == '\t') break;
+                at += key.size();
+            }
+            if (at == std::string::npos) return std::string();
+
+            at += key.size();
+            if (at < header.size() && header[at] == '"') {
+                std::size_t end = header.find('"', at + 1);
+                return header.substr(at + 1, end == std::string::npos ? std::string::npos : end - at - 1);
+            }
+            std::size_t end = header.find(';', at);
+            return header.substr(at, end == std::string::npos ? std::string::npos : end - at);
+        }
+
+        bool beginPart(const char *data, std::size_t size) {
+            m_part = MultipartPart();
+
+            std::size_t pos = 0;
+            while (pos < size) {
+                std::size_t eol = findLineEnd(data + pos, size - pos);
+                std::size_t length = eol == std::string::npos ? size - pos : eol;
+                std::string line(data + pos, length);
+                pos += length + 2;
+
+                std::size_t colon = line.find(':');
+                if (colon == std::string::npos) continue;
+
+                std::string name = line.substr(0, colon);
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                std::size_t valueAt = line.find_first_not_of(" \t", colon + 1);
+                std::string value = valueAt == std::string::npos ? std::string() : line.substr(valueAt);
+
+                if (name == "content-disposition") {
+                    m_part.name = headerParameter(value, "name");
+                    m_part.filename = headerParameter(value, "filename");
+                } else if (name == "content-type") {
+                    m_part.contentType = value;
+                }
+            }
+
+            if (m_part.name.empty()) {
+                fail(MultipartStatus::MALFORMED);
+                return false;
+            }
+
+            m_inPart = true;
+            if (isFile()) {
+                m_fieldValue = nullptr;
+                if (m_sink) m_sink->Begin(m_part);
+            } else {
+                m_fieldValue = &m_fields[m_part.name];
+                if (!m_fieldValue->empty()) {
+                    m_fieldValue->push_back(',');
+                } else {
+                    m_fieldBytes += m_part.name.size();
+                }
+            }
+            return checkFieldBytes(1);
+        }
+
+        bool emit(const char *data, std::size_t size) {
+            if (!m_inPart || size == 0) return true;
+
+            if (isFile()) {
+                if (m_sink) m_sink->Write(m_part, data, size);
+                return true;
+            }
+
+            if (!checkFieldBytes(size)) return false;
+            m_fieldValue->append(data, size);
+            return true;
+        }
+
+        void endPart() {
+            if (!m_inPart) return;
+            if (isFile() && m_sink) m_sink->End(m_part);
+            m_inPart = false;
+            m_fieldValue = nullptr;
+        }
+
+        bool isFile() const {
+            return !m_part.filename.empty();
+        }
+
+        bool checkFieldBytes(std::size_t size) {
+            m_fieldBytes += size;
+            if (m_fieldBytes > m_maxFieldBytes) {
+                fail(MultipartStatus::FIELD_TOO_LARGE);
+                return false;
+            }
+            return true;
+        }
+    };
+
+}
+
+#endif
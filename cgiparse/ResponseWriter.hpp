@@ -0,0 +1,379 @@
+#ifndef CGIPARSE_RESPONSEWRITER_H_w3k9tq5cz1hv8nxe7mbo2ua
+#define CGIPARSE_RESPONSEWRITER_H_w3k9tq5cz1hv8nxe7mbo2ua
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <charconv>
+#include <cmath>
+#include <cerrno>
+#include <type_traits>
+#include <unistd.h>
+#include <sys/uio.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "Urlencoded.hpp"
+
+namespace cgiparse {
+
+    /**
+     * Appends the shortest decimal form of an integer or floating point number.
+     */
+    template<typename Number_T>
+    inline void AppendNumber(std::string &output, Number_T value) {
+        static_assert(std::is_arithmetic<Number_T>::value, "AppendNumber takes numbers");
+        char buffer[64];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        output.append(buffer, static_cast<std::size_t>(result.ptr - buffer));
+    }
+
+    inline void AppendNumber(std::string &output, bool value) {
+        output += value ? "true" : "false";
+    }
+
+    namespace detail {
+
+        inline void JsonEscapeChar(unsigned char c, std::string &output) {
+            static const char digits[] = "0123456789abcdef";
+            switch (c) {
+                case '"': output += "\\\""; break;
+                case '\\': output += "\\\\"; break;
+                case '\n': output += "\\n"; break;
+                case '\r': output += "\\r"; break;
+                case '\t': output += "\\t"; break;
+                case '\b': output += "\\b"; break;
+                case '\f': output += "\\f"; break;
+                default: {
+                    char escape[6] = { '\\', 'u', '0', '0', digits[c >> 4], digits[c & 0xF] };
+                    output.append(escape, sizeof(escape));
+                }
+            }
+        }
+
+        inline bool JsonNeedsEscape(unsigned char c) {
+            return c < 0x20 || c == '"' || c == '\\';
+        }
+
+    }
+
+    /**
+     * Appends input as a quoted JSON string. With SSE2, 16 bytes at a time
+     * are checked for quotes, backslashes and control characters, and runs
+     * that need no escaping are copied as a whole.
+     */
+    inline void JsonEscape(std::string_view input, std::string &output) {
+        const char *data = input.data();
+        std::size_t size = input.size();
+        std::size_t run = 0;
+        std::size_t i = 0;
+
+        output.push_back('"');
+#if defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+        while (i + 16 <= size) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            __m128i mask = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+            unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(mask));
+            if (bits == 0) {
+                i += 16;
+                continue;
+            }
+            i += static_cast<std::size_t>(__builtin_ctz(bits));
+            output.append(data + run, i - run);
+            detail::JsonEscapeChar(static_cast<unsigned char>(data[i]), output);
+            run = ++i;
+        }
+#endif
+        for (; i < size; ++i) {
+            unsigned char c = static_cast<unsigned char>(data[i]);
+            if (!detail::JsonNeedsEscape(c)) continue;
+            output.append(data + run, i - run);
+            detail::JsonEscapeChar(c, output);
+            run = i + 1;
+        }
+        output.append(data + run, size - run);
+        output.push_back('"');
+    }
+
+    /**
+     * Streams JSON into a string. Commas are placed by the writer; keys and
+     * values are expected in a valid order.
+     */
+    class JsonWriter {
+    public:
+        explicit JsonWriter(std::string &output) : m_output(output) {}
+
+        JsonWriter &BeginObject() {
+            separate();
+            m_output.push_back('{');
+            m_comma = false;
+            return *this;
+        }
+
+        JsonWriter &EndObject() {
+            m_output.push_back('}');
+            m_comma = true;
+            return *this;
+        }
+
+        JsonWriter &BeginArray() {
+            separate();
+            m_output.push_back('[');
+            m_comma = false;
+            return *this;
+        }
+
+        JsonWriter &EndArray() {
+            m_output.push_back(']');
+            m_comma = true;
+            return *this;
+        }
+
+        JsonWriter &Key(std::string_view key) {
+            separate();
+            JsonEscape(key, m_output);
+            m_output.push_back(':');
+            m_comma = false;
+            return *this;
+        }
+
+        JsonWriter &Value(std::string_view value) {
+            separate();
+            JsonEscape(value, m_output);
+            return *this;
+        }
+
+        JsonWriter &Value(const char *value) {
+            return Value(std::string_view(value));
+        }
+
+        template<typename Number_T, typename = std::enable_if_t<std::is_arithmetic<Number_T>::value>>
+        JsonWriter &Value(Number_T value) {
+            separate();
+            if constexpr (std::is_floating_point<Number_T>::value) {
+                if (!std::isfinite(value)) {
+                    m_output += "null";
+                    return *this;
+                }
+            }
+            AppendNumber(m_output, value);
+            return *this;
+        }
+
+        template<typename Value_T>
+        JsonWriter &Value(const std::vector<Value_T> &values) {
+            BeginArray();
+            for (const auto &value : values) {
+                Value(value);
+            }
+            return EndArray();
+        }
+
+        JsonWriter &Null() {
+            separate();
+            m_output += "null";
+            return *this;
+        }
+
+        template<typename Value_T>
+        JsonWriter &Field(std::string_view key, const Value_T &value) {
+            Key(key);
+            return Value(value);
+        }
+
+    private:
+        std::string &m_output;
+        bool m_comma = false;
+
+        void separate() {
+            if (m_comma) m_output.push_back(',');
+            m_comma = true;
+        }
+    };
+
+    /**
+     * Streams key=value pairs in form encoding into a string.
+     */
+    class UrlencodedWriter {
+    public:
+        explicit UrlencodedWriter(std::string &output) : m_output(output) {}
+
+        UrlencodedWriter &Field(std::string_view key, std::string_view value) {
+            this->key(key);
+            UrlEncode(value, m_output);
+            return *this;
+        }
+
+        UrlencodedWriter &Field(std::string_view key, const char *value) {
+            return Field(key, std::string_view(value));
+        }
+
+        template<typename Number_T, typename = std::enable_if_t<std::is_arithmetic<Number_T>::value>>
+        UrlencodedWriter &Field(std::string_view key, Number_T value) {
+            this->key(key);
+            AppendNumber(m_output, value);
+            return *this;
+        }
+
+    private:
+        std::string &m_output;
+        bool m_first = true;
+
+        void key(std::string_view key) {
+            if (!m_first) m_output.push_back('&');
+            m_first = false;
+            UrlEncode(key, m_output);
+            m_output.push_back('=');
+        }
+    };
+
+    /**
+     * Collects a CGI response in two preallocated buffers, one for the header
+     * lines and one for the body, and hands both to the kernel with a single
+     * writev. The buffers keep their capacity across Reset, so a writer that
+     * is reused for every response stops allocating once warm.
+     */
+    class ResponseWriter {
+    public:
+        explicit ResponseWriter(std::size_t bodyCapacity = 16 * 1024, std::size_t headCapacity = 512) {
+            m_head.reserve(headCapacity);
+            m_body.reserve(bodyCapacity);
+        }
+
+        /**
+         * Sets the CGI Status header, e.g. Status(404, "Not Found").
+         */
+        ResponseWriter &Status(int code, std::string_view reason) {
+            m_head += "Status: ";
+            AppendNumber(m_head, code);
+            m_head.push_back(' ');
+            m_head.append(reason.data(), reason.size());
+            m_head += "\r\n";
+            return *this;
+        }
+
+        ResponseWriter &Header(std::string_view name, std::string_view value) {
+            m_head.append(name.data(), name.size());
+            m_head += ": ";
+            m_head.append(value.data(), value.size());
+            m_head += "\r\n";
+            return *this;
+        }
+
+        ResponseWriter &ContentType(std::string_view type) {
+            m_hasContentType = true;
+            return Header("Content-Type", type);
+        }
+
+        ResponseWriter &Write(std::string_view text) {
+            m_body.append(text.data(), text.size());
+            return *this;
+        }
+
+        ResponseWriter &Write(const char *text) {
+            return Write(std::string_view(text));
+        }
+
+        template<typename Number_T, typename = std::enable_if_t<std::is_arithmetic<Number_T>::value>>
+        ResponseWriter &Write(Number_T value) {
+            AppendNumber(m_body, value);
+            return *this;
+        }
+
+        /**
+         * A JSON writer appending to the body. Sets the content type to
+         * application/json unless one was given.
+         */
+        JsonWriter Json() {
+            if (!m_hasContentType) ContentType("application/json");
+            return JsonWriter(m_body);
+        }
+
+        /**
+         * A form encoding writer appending to the body.
+         */
+        UrlencodedWriter Urlencoded() {
+            if (!m_hasContentType) ContentType("application/x-www-form-urlencoded");
+            return UrlencodedWriter(m_body);
+        }
+
+        std::string &Body() {
+            return m_body;
+        }
+
+        /**
+         * Appends the whole response to output and resets the writer, for
+         * front ends that own the output stream such as FastCgiRequest::Out.
+         */
+        void AppendTo(std::string &output) {
+            finishHead();
+            output += m_head;
+            output += m_body;
+            Reset();
+        }
+
+        /**
+         * Writes the response to fd and resets the writer. Returns false if
+         * the write failed.
+         */
+        bool Flush(int fd = STDOUT_FILENO) {
+            finishHead();
+
+            iovec parts[2] = {
+                { const_cast<char *>(m_head.data()), m_head.size() },
+                { const_cast<char *>(m_body.data()), m_body.size() }
+            };
+            iovec *part = parts;
+            int count = 2;
+            bool ok = true;
+
+            while (count > 0) {
+                ssize_t written = ::writev(fd, part, count);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    ok = false;
+                    break;
+                }
+                std::size_t left = static_cast<std::size_t>(written);
+                while (count > 0 && left >= part->iov_len) {
+                    left -= part->iov_len;
+                    ++part;
+                    --count;
+                }
+                if (count > 0) {
+                    part->iov_base = static_cast<char *>(part->iov_base) + left;
+                    part->iov_len -= left;
+                }
+            }
+
+            Reset();
+            return ok;
+        }
+
+        void Reset() {
+            m_head.clear();
+            m_body.clear();
+            m_hasContentType = false;
+        }
+
+    private:
+        std::string m_head;
+        std::string m_body;
+        bool m_hasContentType = false;
+
+        void finishHead() {
+            if (!m_hasContentType) ContentType("text/plain; charset=utf-8");
+            m_head += "Content-Length: ";
+            AppendNumber(m_head, m_body.size());
+            m_head += "\r\n\r\n";
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef CGIPARSE_SCHEMA_H_vn38fkq02mzla91ckw7xe5d
+#define CGIPARSE_SCHEMA_H_vn38fkq02mzla91ckw7xe5d
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <bitset>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+#include "Cgiparse.hpp"
+#include "Urlencoded.hpp"
+
+namespace cgiparse {
+
+    template<typename Object_T, typename Member_T, char delimiter = ','>
+    struct Field {
+        using Object_t = Object_T;
+        using Member_t = Member_T;
+        static constexpr char Delimiter = delimiter;
+
+        Member_T Object_T::*member;
+        std::string_view key;
+        bool required;
+    };
+
+    template<char delimiter = ',', typename Object_T, typename Member_T>
+    constexpr Field<Object_T, Member_T, delimiter> Required(Member_T Object_T::*member, std::string_view key) {
+        return { member, key, true };
+    }
+
+    template<char delimiter = ',', typename Object_T, typename Member_T>
+    constexpr Field<Object_T, Member_T, delimiter> Optional(Member_T Object_T::*member, std::string_view key) {
+        return { member, key, false };
+    }
+
+    /**
+     * A compile-time description of the inputs of Object_T. The keys are
+     * placed in a perfect hash table when the schema is constructed, so
+     * a constexpr schema does all of the key layout during compilation.
+     * Parse scans an urlencoded input once and dispatches every key/value
+     * pair straight into its member.
+     */
+    template<typename Object_T, typename... Fields_T>
+    class Schema {
+        static constexpr std::size_t s_size = sizeof...(Fields_T);
+        static constexpr std::size_t s_empty = s_size;
+
+        static constexpr std::size_t tableSize() {
+            std::size_t size = 1;
+            while (size < s_size * 2) size <<= 1;
+            return size;
+        }
+
+        static constexpr std::size_t s_tableSize = tableSize();
+
+    public:
+        using Object_t = Object_T;
+
+        constexpr Schema(Fields_T... fields)
+            : m_fields(fields...)
+            , m_keys{ fields.key... } {
+            for (std::uint32_t seed = 0; seed < 100000; ++seed) {
+                if (tryLayout(seed)) {
+                    m_seed = seed;
+                    return;
+                }
+            }
+            throw std::logic_error("cgiparse::Schema: no perfect hash for the keys, are they unique?");
+        }
+
+        static constexpr std::size_t size() {
+            return s_size;
+        }
+
+        constexpr std::string_view key(std::size_t id) const {
+            return m_keys[id];
+        }
+
+        /**
+         * Returns the field id of key or size() when the key is not in the schema.
+         */
+        constexpr std::size_t find(std::string_view key) const {
+            std::size_t id = m_table[hash(key, m_seed) & (s_tableSize - 1)];
+            return (id != s_empty && m_keys[id] == key) ? id : s_empty;
+        }
+
+        /**
+         * Parses an urlencoded input such as a QUERY_STRING in a single scan.
+         * A key given more than once keeps its first value. onError(fieldId, key, type, index) is called for every bad value and
+         * for every required field that is absent. scratch is used for decoding
+         * and keeps its capacity between calls.
+         */
+        template<typename Deserializer_T, typename OnError_T>
+        void Parse(Object_T &object, std::string_view input, Deserializer_T &deserializer, std::string &scratch, OnError_T &&onError) const {
+            std::bitset<s_size == 0 ? 1 : s_size> seen;
+
+            while (!input.empty()) {
+                std::size_t amp = input.find('&');
+                std::string_view pair = input.substr(0, amp);
+                input = amp == std::string_view::npos ? std::string_view() : input.substr(amp + 1);
+
+                std::size_t eq = pair.find('=');
+                std::string_view key = pair.substr(0, eq);
+                std::string_view value = eq == std::string_view::npos ? std::string_view() : pair.substr(eq + 1);
+
+                std::size_t id;
+                if (isEncoded(key)) {
+                    UrlDecode(key, scratch);
+                    id = find(scratch);
+                } else {
+                    id = find(key);
+                }
+                // The first occurrence of a key wins, as in QueryIndex::Find
+                if (id == s_empty || seen.test(id)) continue;
+
+                seen.set(id);
+                dispatch(id, object, value, deserializer, scratch, onError, std::index_sequence_for<Fields_T...>{});
+            }
+
+            reportMissing(seen, onError, std::index_sequence_for<Fields_T...>{});
+        }
+
+    private:
+        std::tuple<Fields_T...> m_fields;
+        std::array<std::string_view, s_size> m_keys;
+        std::array<std::size_t, s_tableSize> m_table{};
+        std::uint32_t m_seed = 0;
+
+        static constexpr std::uint32_t hash(std::string_view key, std::uint32_t seed) {
+            std::uint32_t h = 2166136261u ^ seed;
+            for (char c : key) {
+                h ^= static_cast<unsigned char>(c);
+                h *= 16777619u;
+            }
+            return h ^ (h >> 15);
+        }
+
+        constexpr bool tryLayout(std::uint32_t seed) {
+            for (std::size_t i = 0; i < s_tableSize; ++i) {
+                m_table[i] = s_empty;
+            }
+            for (std::size_t id = 0; id < s_size; ++id) {
+                std::size_t &slot = m_table[hash(m_keys[id], seed) & (s_tableSize - 1)];
+                if (slot != s_empty) return false;
+                slot = id;
+            }
+            return true;
+        }
+
+        template<typename Deserializer_T, typename OnError_T, std::size_t... I>
+        void dispatch(std::size_t id, Object_T &object, std::string_view value, Deserializer_T &deserializer,
+                      std::string &scratch, OnError_T &onError, std::index_sequence<I...>) const {
+            using Handler_t = void (*)(const Schema &, Object_T &, std::string_view, Deserializer_T &, std::string &, OnError_T &);
+            static constexpr Handler_t handlers[] = { &Schema::assign<I, Deserializer_T, OnError_T>... };
+            handlers[id](*this, object, value, deserializer, scratch, onError);
+        }
+
+        template<std::size_t I, typename Deserializer_T, typename OnError_T>
+        static void assign(const Schema &self, Object_T &object, std::string_view value, Deserializer_T &deserializer, std::string &scratch, OnError_T &onError) {
+            const auto &field = std::get<I>(self.m_fields);
+            self.assignValue<std::decay_t<decltype(field)>::Delimiter>(object.*(field.member), I, field.required, value, deserializer, scratch, onError);
+        }
+
+        template<char delimiter, typename T, typename Deserializer_T, typename OnError_T>
+        void assignValue(T &member, std::size_t id, bool required, std::string_view value,
+                         Deserializer_T &deserializer, std::string &scratch, OnError_T &onError) const {
+            deserializeInto(member, id, required, 0, value, deserializer, scratch, onError);
+        }
+
+        template<char delimiter, typename T, typename Deserializer_T, typename OnError_T>
+        void assignValue(std::vector<T> &member, std::size_t id, bool required, std::string_view value,
+                         Deserializer_T &deserializer, std::string &scratch, OnError_T &onError) const {
+            // Decode before splitting like the getter inputs, so an encoded delimiter still splits
+            decode(value, scratch);
+            std::string_view decoded = scratch;
+
+            // Same splitting as the getter inputs, a trailing delimiter does not add an element
+            std::size_t count = 0;
+            for (std::size_t at = 0; at < decoded.size(); ++count) {
+                std::size_t next = decoded.find(delimiter, at);
+                at = next == std::string_view::npos ? decoded.size() : next + 1;
+            }
+
+            member.resize(count);
+            std::string element;
+            std::size_t at = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                std::size_t next = decoded.find(delimiter, at);
+                element.assign(decoded.substr(at, next == std::string_view::npos ? std::string_view::npos : next - at));
+                at = next + 1;
+                deserializeDecoded(member[i], id, required, i, element, deserializer, onError);
+            }
+        }
+
+        // Two memchr scans, find_first_of tests the character set one byte at a time
+        static bool isEncoded(std::string_view value) {
+            return value.find('%') != std::string_view::npos || value.find('+') != std::string_view::npos;
+        }
+
+        static void decode(std::string_view value, std::string &scratch) {
+            if (isEncoded(value)) {
+                UrlDecode(value, scratch);
+            } else {
+                scratch.assign(value.data(), value.size());
+            }
+        }
+
+        template<typename T, typename Deserializer_T, typename OnError_T>
+        void deserializeInto(T &member, std::size_t id, bool required, std::size_t index, std::string_view value,
+                             Deserializer_T &deserializer, std::string &scratch, OnError_T &onError) const {
+            decode(value, scratch);
+            deserializeDecoded(member, id, required, index, scratch, deserializer, onError);
+        }
+
+        template<typename T, typename Deserializer_T, typename OnError_T>
+        void deserializeDecoded(T &member, std::size_t id, bool required, std::size_t index, const std::string &value,
+                                Deserializer_T &deserializer, OnError_T &onError) const {
+            CgiInputErrorTypes result = deserializer.deserialize(member, value);
+            if (result != CgiInputErrorTypes::OK && (required || result != CgiInputErrorTypes::MISSING)) {
+                onError(id, m_keys[id], result, index);
+            }
+        }
+
+        template<typename OnError_T, std::size_t... I>
+        void reportMissing(const std::bitset<s_size == 0 ? 1 : s_size> &seen, OnError_T &onError, std::index_sequence<I...>) const {
+            ((std::get<I>(m_fields).required && !seen.test(I) ? onError(I, m_keys[I], CgiInputErrorTypes::MISSING, 0) : void()), ...);
+        }
+    };
+
+    template<typename Object_T, typename... Fields_T>
+    constexpr Schema<Object_T, Fields_T...> MakeSchema(Fields_T... fields) {
+        return Schema<Object_T, Fields_T...>(fields...);
+    }
+
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef CGIPARSE_URLENCODED_H_p2m8xnc0q7wkd1z9afj4le6
+#define CGIPARSE_URLENCODED_H_p2m8xnc0q7wkd1z9afj4le6
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include "Cgiparse.hpp"
+
+namespace cgiparse {
+
+    /**
+     * Decodes the '+' and %XX escapes of an urlencoded string into output.
+     */
+    inline void UrlDecode(std::string_view input, std::string &output) {
+        auto hex = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        };
+
+        output.clear();
+        for (std::size_t i = 0; i < input.size(); ++i) {
+            char c = input[i];
+            if (c == '+') {
+                output.push_back(' ');
+            } else if (c == '%' && i + 2 < input.size() && hex(input[i + 1]) >= 0 && hex(input[i + 2]) >= 0) {
+                output.push_back(static_cast<char>(hex(input[i + 1]) * 16 + hex(input[i + 2])));
+                i += 2;
+            } else {
+                output.push_back(c);
+            }
+        }
+    }
+
+    /**
+     * Appends input to output in form encoding: unreserved characters as they
+     * are, spaces as '+' and everything else as %XX. Runs of unreserved
+     * characters are copied in one go.
+     */
+    inline void UrlEncode(std::string_view input, std::string &output) {
+        static const char digits[] = "0123456789ABCDEF";
+        auto unreserved = [](unsigned char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                || c == '-' || c == '.' || c == '_' || c == '~';
+        };
+
+        std::size_t run = 0;
+        for (std::size_t i = 0; i < input.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(input[i]);
+            if (unreserved(c)) continue;
+
+            output.append(input.data() + run, i - run);
+            if (c == ' ') {
+                output.push_back('+');
+            } else {
+                char escape[3] = { '%', digits[c >> 4], digits[c & 0xF] };
+                output.append(escape, sizeof(escape));
+            }
+            run = i + 1;
+        }
+        output.append(input.data() + run, input.size() - run);
+    }
+
+
+    /**
+     * Decoded key/value pairs of an urlencoded input such as QUERY_STRING.
+     * The entries and their strings are kept between calls to Parse, so an
+     * index that lives as long as the process stops allocating once warm.
+     */
+    class QueryIndex {
+    public:
+        void Parse(std::string_view input) {
+            m_size = 0;
+            while (!input.empty()) {
+                std::size_t amp = input.find('&');
+                std::string_view pair = input.substr(0, amp);
+                input = amp == std::string_view::npos ? std::string_view() : input.substr(amp + 1);
+                if (pair.empty()) continue;
+
+                if (m_size == m_entries.size()) m_entries.emplace_back();
+                auto &entry = m_entries[m_size++];
+
+                std::size_t eq = pair.find('=');
+                UrlDecode(pair.substr(0, eq), entry.first);
+                UrlDecode(eq == std::string_view::npos ? std::string_view() : pair.substr(eq + 1), entry.second);
+            }
+        }
+
+        /**
+         * Returns the value of the first entry with the key, or nullptr.
+         */
+        const std::string *Find(std::string_view key) const {
+            for (std::size_t i = 0; i < m_size; ++i) {
+                if (m_entries[i].first == key) return &m_entries[i].second;
+            }
+            return nullptr;
+        }
+
+        cgiparse::Getter_t Getter() const {
+            return [this](const std::string &key) {
+                const std::string *value = Find(key);
+                return value ? *value : std::string();
+            };
+        }
+
+        std::size_t size() const {
+            return m_size;
+        }
+
+    private:
+        std::vector<std::pair<std::string, std::string>> m_entries;
+        std::size_t m_size = 0;
+    };
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "sqlite_connect/sqlite_connect.hpp"
+
+// Counts forever, one row per step, and says when its first row is out
+struct endless_query : public sqlite_connect::iquery
+{
+    std::atomic<bool> started{false};
+
+    const char *sql() const override
+    {
+        return "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n) SELECT i FROM n";
+    }
+
+    void execute(statement_ptr stmt) override
+    {
+        // Only a statement that is already running sees the interrupt
+        while (stmt->step())
+        {
+            started = true;
+        }
+    }
+};
+
+struct sql_query : public sqlite_connect::iquery
+{
+    const char *text;
+
+    explicit sql_query(const char *text) : text(text) {}
+
+    const char *sql() const override
+    {
+        return text;
+    }
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        std::cout << "FAIL " << what << "\n";
+        ++failures;
+    }
+}
+
+// Whether the future completed with a database_exception
+static bool fails(std::future<void> &future)
+{
+    try
+    {
+        future.get();
+        return false;
+    }
+    catch (sqlite_connect::database_exception const &)
+    {
+        return true;
+    }
+}
+
+/*
+ * Cancelling a queued job completes it at once and frees its queue slot,
+ * and cancelling a running one does not leave the worker's connection
+ * interrupted for the jobs after it.
+ */
+int main()
+{
+    sqlite_connect::async_executor executor(":memory:", 1);
+
+    auto query = std::make_shared<endless_query>();
+    auto endless = executor.submit(query);
+    while (!query->started)
+    {
+        std::this_thread::yield();
+    }
+
+    auto queued = executor.submit(std::make_shared<sql_query>("SELECT 1"));
+    check(executor.queued() == 1, "the second job waits behind the running one");
+    check(queued.ticket.cancel(), "a queued job can be cancelled");
+    check(executor.queued() == 0, "a cancelled job leaves the queue");
+    check(queued.future.wait_for(std::chrono::seconds(0)) == std::future_status::ready,
+          "a cancelled queued job completes at once");
+    check(fails(queued.future), "a cancelled queued job reports the cancellation");
+
+    check(endless.ticket.cancel(), "a running job can be cancelled");
+    check(fails(endless.future), "an interrupted job reports the interrupt");
+    check(!endless.ticket.cancel(), "a completed job cannot be cancelled");
+
+    auto create = executor.submit(std::make_shared<sql_query>("CREATE TABLE tab (x INTEGER)"));
+    auto insert = executor.submit(std::make_shared<sql_query>("INSERT INTO tab VALUES (1)"));
+    check(!fails(create.future) && !fails(insert.future), "jobs after a cancelled one run");
+
+    std::cout << (failures == 0 ? "async_executor: ok\n" : "async_executor: failed\n");
+    return failures == 0 ? 0 : 1;
+}
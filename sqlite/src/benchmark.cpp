@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sqlite_connect/sqlite_connect.hpp"
+
+struct insert_query : public sqlite_connect::iquery
+{
+    long long id = 0;
+    long long x = 0;
+    std::string_view name;
+
+    const char *sql() const override
+    {
+        return "INSERT INTO bench (id, x, name) VALUES (?1, ?2, ?3)";
+    }
+
+    void execute(statement_ptr stmt) override
+    {
+        stmt->bind(1, id);
+        stmt->bind(2, x);
+        stmt->bind(3, name, sqlite_connect::lifetime::STATIC);
+        stmt->step();
+    }
+};
+
+struct lookup_query : public sqlite_connect::iquery
+{
+    long long id = 0;
+    long long x = 0;
+    size_t name_size = 0;
+
+    const char *sql() const override
+    {
+        return "SELECT x, name FROM bench WHERE id = ?1";
+    }
+
+    void execute(statement_ptr stmt) override
+    {
+        stmt->bind(1, id);
+        if (stmt->step())
+        {
+            std::string_view name;
+            stmt->extract_column(0, x);
+            stmt->extract_column(1, name);
+            name_size = name.size();
+        }
+        stmt->reset();
+    }
+};
+
+struct upsert_query : public sqlite_connect::iquery
+{
+    long long id = 0;
+
+    const char *sql() const override
+    {
+        return "INSERT INTO bench (id, x, name) VALUES (?1, 0, 'new') "
+               "ON CONFLICT (id) DO UPDATE SET x = x + 1";
+    }
+
+    void execute(statement_ptr stmt) override
+    {
+        stmt->bind(1, id);
+        stmt->step();
+    }
+};
+
+struct scan_query : public sqlite_connect::iquery
+{
+    long long sum = 0;
+
+    const char *sql() const override
+    {
+        return "SELECT id, x, name FROM bench";
+    }
+
+    void execute(statement_ptr stmt) override
+    {
+        long long id, x;
+        std::string_view name;
+        while (stmt->step())
+        {
+            stmt->extract_column(0, id);
+            stmt->extract_column(1, x);
+            stmt->extract_column(2, name);
+            sum += id + x + static_cast<long long>(name.size());
+        }
+        stmt->reset();
+    }
+};
+
+// Best of three runs, setup runs untimed before each
+static double time_ns_per_op(size_t ops, std::function<void()> const &run, std::function<void()> const &setup = nullptr)
+{
+    double best = 0;
+    for (int attempt = 0; attempt < 3; ++attempt)
+    {
+        if (setup)
+        {
+            setup();
+        }
+        auto start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        double ns = elapsed.count() / static_cast<double>(ops);
+        best = attempt == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+static void report(const char *workload, const char *path, double raw_ns, double ns)
+{
+    std::printf("%-14s %-16s %10.1f %10.1f %+10.1f %+8.1f%%\n", workload, path, raw_ns, ns, ns - raw_ns,
+                100.0 * (ns - raw_ns) / raw_ns);
+}
+
+static sqlite3_stmt *raw_prepare(sqlite3 *db, const char *sql)
+{
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        throw sqlite_connect::database_exception(sqlite3_errmsg(db));
+    }
+    return stmt;
+}
+
+static void reset_table(sqlite_connect::connection &db)
+{
+    db.execute_query("DROP TABLE IF EXISTS bench");
+    db.execute_query("CREATE TABLE bench (id INTEGER PRIMARY KEY, x INTEGER, name TEXT)");
+}
+
+/*
+ * Runs insert, point lookup, upsert, scan and failing insert workloads both
+ * through raw sqlite3_* calls and through sqlite_connect, on one connection,
+ * and prints the cost of each per operation:
+ *
+ *   sqlite_bench [rows] [file]
+ *
+ * Raw statements are prepared once per run, as a hand-tuned caller would,
+ * so the difference is what the wrapper adds per operation. Each number is
+ * the best of three runs.
+ */
+int main(int argc, char **argv)
+{
+    size_t rows = argc > 1 ? std::stoul(argv[1]) : 200000;
+    std::string name = argc > 2 ? argv[2] : ":memory:";
+    size_t lookups = rows;
+    size_t scans = 20;
+    size_t failures = 20000;
+
+    sqlite_connect::connection db(name);
+    sqlite3 *raw = static_cast<sqlite3 *>(db);
+
+    std::vector<std::string> names;
+    names.reserve(rows);
+    for (size_t i = 0; i < rows; ++i)
+    {
+        names.push_back("row " + std::to_string(i));
+    }
+    std::vector<long long> ids(lookups);
+    std::mt19937_64 random(42);
+    for (auto &id : ids)
+    {
+        id = static_cast<long long>(random() % rows + 1);
+    }
+
+    std::printf("%-14s %-16s %10s %10s %11s %9s\n", "workload", "path", "raw ns/op", "ns/op", "overhead", "");
+
+    // insert
+    double raw_insert = time_ns_per_op(rows, [&]() {
+        sqlite3_exec(raw, "BEGIN", nullptr, nullptr, nullptr);
+        sqlite3_stmt *stmt = raw_prepare(raw, "INSERT INTO bench (id, x, name) VALUES (?1, ?2, ?3)");
+        for (size_t i = 0; i < rows; ++i)
+        {
+            sqlite3_bind_int64(stmt, 1, static_cast<long long>(i + 1));
+            sqlite3_bind_int64(stmt, 2, static_cast<long long>(i % 1000));
+            sqlite3_bind_text(stmt, 3, names[i].data(), static_cast<int>(names[i].size()), SQLITE_STATIC);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+        sqlite3_exec(raw, "COMMIT", nullptr, nullptr, nullptr);
+    }, [&]() { reset_table(db); });
+
+    double iquery_insert = time_ns_per_op(rows, [&]() {
+        db.execute_query("BEGIN");
+        insert_query insert;
+        for (size_t i = 0; i < rows; ++i)
+        {
+            insert.id = static_cast<long long>(i + 1);
+            insert.x = static_cast<long long>(i % 1000);
+            insert.name = names[i];
+            db.execute_query(insert);
+        }
+        db.execute_query("COMMIT");
+    }, [&]() { reset_table(db); });
+    report("insert", "iquery", raw_insert, iquery_insert);
+
+    // point lookup
+    long long checksum = 0;
+    double raw_lookup = time_ns_per_op(lookups, [&]() {
+        sqlite3_stmt *stmt = raw_prepare(raw, "SELECT x, name FROM bench WHERE id = ?1");
+        for (long long id : ids)
+        {
+            sqlite3_bind_int64(stmt, 1, id);
+            if (sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                checksum += sqlite3_column_int64(stmt, 0) + sqlite3_column_bytes(stmt, 1);
+            }
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+    });
+
+    double iquery_lookup = time_ns_per_op(lookups, [&]() {
+        lookup_query lookup;
+        for (long long id : ids)
+        {
+            lookup.id = id;
+            db.execute_query(lookup);
+            checksum += lookup.x + static_cast<long long>(lookup.name_size);
+        }
+    });
+    report("point lookup", "iquery", raw_lookup, iquery_lookup);
+
+    double typed_lookup = time_ns_per_op(lookups, [&]() {
+        for (long long id : ids)
+        {
+            for (auto [x, text] : sqlite_connect::query<long long, std::string_view>(db, "SELECT x, name FROM bench WHERE id = ?1", id))
+            {
+                checksum += x + static_cast<long long>(text.size());
+            }
+        }
+    });
+    report("point lookup", "typed query", raw_lookup, typed_lookup);
+
+    // upsert
+    double raw_upsert = time_ns_per_op(lookups, [&]() {
+        sqlite3_exec(raw, "BEGIN", nullptr, nullptr, nullptr);
+        sqlite3_stmt *stmt = raw_prepare(raw, "INSERT INTO bench (id, x, name) VALUES (?1, 0, 'new') "
+                                              "ON CONFLICT (id) DO UPDATE SET x = x + 1");
+        for (long long id : ids)
+        {
+            sqlite3_bind_int64(stmt, 1, id);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+        sqlite3_exec(raw, "COMMIT", nullptr, nullptr, nullptr);
+    });
+
+    double iquery_upsert = time_ns_per_op(lookups, [&]() {
+        db.execute_query("BEGIN");
+        upsert_query upsert;
+        for (long long id : ids)
+        {
+            upsert.id = id;
+            db.execute_query(upsert);
+        }
+        db.execute_query("COMMIT");
+    });
+    report("upsert", "iquery", raw_upsert, iquery_upsert);
+
+    // full scan, per row
+    double raw_scan = time_ns_per_op(scans * rows, [&]() {
+        sqlite3_stmt *stmt = raw_prepare(raw, "SELECT id, x, name FROM bench");
+        for (size_t i = 0; i < scans; ++i)
+        {
+            while (sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                checksum += sqlite3_column_int64(stmt, 0) + sqlite3_column_int64(stmt, 1);
+                checksum += static_cast<long long>(std::string_view(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 2)),
+                                                                    sqlite3_column_bytes(stmt, 2)).size());
+            }
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+    });
+
+    double iquery_scan = time_ns_per_op(scans * rows, [&]() {
+        scan_query scan;
+        for (size_t i = 0; i < scans; ++i)
+        {
+            db.execute_query(scan);
+        }
+        checksum += scan.sum;
+    });
+    report("scan (per row)", "iquery", raw_scan, iquery_scan);
+
+    double typed_scan = time_ns_per_op(scans * rows, [&]() {
+        for (size_t i = 0; i < scans; ++i)
+        {
+            for (auto [id, x, text] : sqlite_connect::query<long long, long long, std::string_view>(db, "SELECT id, x, name FROM bench"))
+            {
+                checksum += id + x + static_cast<long long>(text.size());
+            }
+        }
+    });
+    report("scan (per row)", "typed query", raw_scan, typed_scan);
+
+    // failing insert, the error path
+    double raw_failure = time_ns_per_op(failures, [&]() {
+        sqlite3_stmt *stmt = raw_prepare(raw, "INSERT INTO bench (id, x, name) VALUES (?1, ?2, ?3)");
+        for (size_t i = 0; i < failures; ++i)
+        {
+            sqlite3_bind_int64(stmt, 1, 1);
+            sqlite3_bind_int64(stmt, 2, 0);
+            sqlite3_bind_text(stmt, 3, "dup", 3, SQLITE_STATIC);
+            if (sqlite3_step(stmt) != SQLITE_DONE)
+            {
+                checksum += static_cast<long long>(std::string_view(sqlite3_errmsg(raw)).size());
+            }
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+    });
+
+    double iquery_failure = time_ns_per_op(failures, [&]() {
+        insert_query insert;
+        insert.id = 1;
+        insert.name = "dup";
+        for (size_t i = 0; i < failures; ++i)
+        {
+            try
+            {
+                db.execute_query(insert);
+            }
+            catch (sqlite_connect::database_exception const &e)
+            {
+                checksum += static_cast<long long>(std::string_view(e.what()).size());
+            }
+        }
+    });
+    report("failing insert", "iquery", raw_failure, iquery_failure);
+
+    std::cout << "(checksum " << checksum << ")\n";
+    return 0;
+}
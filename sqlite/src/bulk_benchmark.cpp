@@ -0,0 +1,101 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "sqlite_connect/sqlite_connect.hpp"
+
+struct create_table_query : public sqlite_connect::iquery
+{
+    const char *sql() const override
+    {
+        return "CREATE TABLE bench ( "
+               "id INTEGER PRIMARY KEY, x INTEGER, y REAL, name TEXT "
+               ")";
+    }
+};
+
+struct insert_query : public sqlite_connect::iquery
+{
+    struct record
+    {
+        long long id;
+        int x;
+        double y;
+        std::string name;
+    } const *row = nullptr;
+
+    const char *sql() const override
+    {
+        return "INSERT INTO bench (id, x, y, name) VALUES (?1, ?2, ?3, ?4)";
+    }
+
+    void execute(statement_ptr stmt) override
+    {
+        stmt->bind(1, row->id);
+        stmt->bind(2, row->x);
+        stmt->bind(3, row->y);
+        stmt->bind(4, row->name);
+        stmt->step();
+    }
+};
+
+using record = insert_query::record;
+
+static std::vector<record> make_rows(size_t count)
+{
+    std::vector<record> rows;
+    rows.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        rows.push_back(record{static_cast<long long>(i + 1), static_cast<int>(i % 1000), i * 0.5, "row " + std::to_string(i)});
+    }
+    return rows;
+}
+
+/*
+ * One execute_query per row inside a single transaction, against bulk_insert.
+ */
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    std::string name = argc > 2 ? argv[2] : ":memory:";
+    auto rows = make_rows(count);
+
+    {
+        auto db = std::make_shared<sqlite_connect::connection>(name);
+        create_table_query create;
+        db->execute_query(create);
+
+        insert_query insert;
+        auto start = std::chrono::steady_clock::now();
+        {
+            sqlite_connect::transaction transaction(db);
+            for (auto const &row : rows)
+            {
+                insert.row = &row;
+                transaction.execute_query(insert);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "execute_query per row: " << static_cast<long long>(count / seconds) << " rows/s\n";
+        db->execute_query("DROP TABLE bench");
+    }
+
+    {
+        sqlite_connect::connection db(name);
+        create_table_query create;
+        db.execute_query(create);
+
+        sqlite_connect::bulk_insert bulk(db, "bench", {"id", "x", "y", "name"});
+        auto result = bulk.insert(rows, [](record const &row) {
+            return std::tie(row.id, row.x, row.y, row.name);
+        });
+        std::cout << "bulk_insert:           " << static_cast<long long>(result.rows_per_second()) << " rows/s ("
+                  << bulk.rows_per_statement() << " rows per statement)\n";
+        db.execute_query("DROP TABLE bench");
+    }
+
+    return 0;
+}
@@ -51,36 +51,15 @@ struct upsert_query : public sqlite_connect::iquery
     }
 };
 
-struct select_query : public sqlite_connect::iquery
+struct record
 {
-    struct record
-    {
-        int64_t id;
-        int x;
-        double y;
-    };
-
-    std::vector<record> records;
-
-    const char *sql() const override
-    {
-        return "SELECT * FROM tab";
-    }
-
-    void execute(statement_ptr stmt) override
-    {
-        records.clear();
-        while (stmt->step())
-        {
-            record r;
-            stmt->extract_column(0, r.id);
-            stmt->extract_column(1, r.x);
-            stmt->extract_column(2, r.y);
-            records.push_back(r);
-        }
-    }
+    int64_t id;
+    int x;
+    double y;
 };
 
+static const char *select_sql = "SELECT id, x, y FROM tab";
+
 int main(void)
 {
     auto connection = std::make_shared<sqlite_connect::connection>();
@@ -96,11 +75,9 @@ int main(void)
         transaction.execute_query(insert);
     }
 
-    select_query select;
-
-    connection->execute_query(select);
+    auto records = sqlite_connect::query_as<record, int64_t, int, double>(*connection, select_sql).to_vector();
 
-    for (auto const &r : select.records)
+    for (auto const &r : records)
     {
         std::cout << "(id: " << r.id << ", x: " << r.x << ", y: " << r.y << ")\n";
     }
@@ -113,12 +90,11 @@ int main(void)
 
     connection->execute_query(upsert);
 
-    connection->execute_query(select);
-
-    for (auto const &r : select.records)
+    for (auto const &[id, x, y] : sqlite_connect::query<int64_t, int, double>(*connection, select_sql))
     {
-        std::cout << "(id: " << r.id << ", x: " << r.x << ", y: " << r.y << ")\n";
+        std::cout << "(id: " << id << ", x: " << x << ", y: " << y << ")\n";
     }
 
     return 0;
 }
+
@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sqlite_connect/sqlite_connect.hpp"
+
+using sqlite_connect::connection_options;
+
+static void remove_database(std::string const &name)
+{
+    for (const char *suffix : {"", "-wal", "-shm", "-journal"})
+    {
+        std::remove((name + suffix).c_str());
+    }
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * Runs the same insert, point-select and range-scan workloads on a fresh
+ * database file under each connection profile:
+ *
+ *   sqlite_options_bench [rows] [file]
+ *
+ * Inserts commit every 1000 rows, point selects look up random ids, and
+ * range scans read 100 consecutive values of an indexed column.
+ */
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 200000;
+    std::string name = argc > 2 ? argv[2] : "options_bench.db";
+    const size_t batch = 1000;
+    const size_t lookups = 200000;
+    const size_t scans = 20000;
+    const long long span = 100;
+
+    std::vector<std::pair<const char *, connection_options>> profiles = {
+        {"default", connection_options()},
+        {"read_heavy", connection_options::read_heavy()},
+        {"write_heavy", connection_options::write_heavy()},
+        {"ephemeral", connection_options::ephemeral()},
+    };
+
+    for (auto const &[profile, options] : profiles)
+    {
+        remove_database(name);
+        std::mt19937_64 random(42);
+        std::cout << profile << " (" << options.describe() << ")\n";
+
+        {
+            sqlite_connect::connection db(name, options);
+            db.execute_query("CREATE TABLE bench (id INTEGER PRIMARY KEY, k INTEGER, v TEXT)");
+            db.execute_query("CREATE INDEX bench_k ON bench (k)");
+
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < count;)
+            {
+                db.execute_query("BEGIN");
+                auto insert = db.prepare("INSERT INTO bench (id, k, v) VALUES (?1, ?2, ?3)");
+                for (size_t end = std::min(count, i + batch); i < end; ++i)
+                {
+                    insert->bind_value(1, i + 1);
+                    insert->bind_value(2, static_cast<long long>(random() % count));
+                    insert->bind_value(3, "value " + std::to_string(i));
+                    insert->step();
+                    insert->reset();
+                }
+                insert.reset();
+                db.execute_query("COMMIT");
+            }
+            std::cout << "  insert:       " << static_cast<long long>(count / seconds_since(start)) << " rows/s\n";
+
+            auto select = db.prepare("SELECT v FROM bench WHERE id = ?1");
+            size_t found = 0;
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < lookups; ++i)
+            {
+                select->bind_value(1, static_cast<long long>(random() % count + 1));
+                found += select->step();
+                select->reset();
+            }
+            std::cout << "  point select: " << static_cast<long long>(lookups / seconds_since(start)) << " queries/s ("
+                      << found << " found)\n";
+
+            auto scan = db.prepare("SELECT id, v FROM bench WHERE k >= ?1 AND k < ?2");
+            size_t rows = 0;
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < scans; ++i)
+            {
+                long long from = static_cast<long long>(random() % count);
+                scan->bind_value(1, from);
+                scan->bind_value(2, from + span);
+                while (scan->step())
+                {
+                    ++rows;
+                }
+                scan->reset();
+            }
+            double elapsed = seconds_since(start);
+            std::cout << "  range scan:   " << static_cast<long long>(scans / elapsed) << " scans/s, "
+                      << static_cast<long long>(rows / elapsed) << " rows/s\n";
+        }
+    }
+
+    remove_database(name);
+    return 0;
+}
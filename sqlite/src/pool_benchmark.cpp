@@ -0,0 +1,134 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sqlite_connect/sqlite_connect.hpp"
+
+struct create_table_query : public sqlite_connect::iquery
+{
+    const char *sql() const override
+    {
+        return "CREATE TABLE IF NOT EXISTS bench ( "
+               "id INTEGER PRIMARY KEY, x INTEGER, name TEXT "
+               ")";
+    }
+};
+
+struct insert_query : public sqlite_connect::iquery
+{
+    long long id = 0;
+
+    const char *sql() const override
+    {
+        return "INSERT INTO bench (id, x, name) VALUES (?1, ?1 * 7, 'row')";
+    }
+
+    void execute(statement_ptr stmt) override
+    {
+        stmt->bind(1, id);
+        stmt->step();
+    }
+};
+
+struct point_query : public sqlite_connect::iquery
+{
+    long long id = 0;
+    long long x = 0;
+
+    const char *sql() const override
+    {
+        return "SELECT x FROM bench WHERE id = ?1";
+    }
+
+    void execute(statement_ptr stmt) override
+    {
+        stmt->bind(1, id);
+        if (stmt->step())
+        {
+            stmt->extract_column(0, x);
+        }
+    }
+};
+
+static void remove_database(std::string const &name)
+{
+    std::remove(name.c_str());
+    std::remove((name + "-wal").c_str());
+    std::remove((name + "-shm").c_str());
+}
+
+/*
+ * Point reads on 1..N threads against one pool, each thread for a fixed time.
+ */
+int main(int argc, char **argv)
+{
+    std::string name = argc > 1 ? argv[1] : "pool_bench.db";
+    size_t max_threads = argc > 2 ? std::stoul(argv[2]) : 8;
+    const long long rows = 100000;
+    const auto duration = std::chrono::seconds(1);
+
+    remove_database(name);
+    sqlite_connect::connection_pool pool(name, max_threads);
+
+    {
+        auto writer = pool.writer();
+        sqlite_connect::transaction transaction(writer.shared());
+        create_table_query create;
+        insert_query insert;
+
+        transaction.execute_query(create);
+        for (insert.id = 1; insert.id <= rows; ++insert.id)
+        {
+            transaction.execute_query(insert);
+        }
+    }
+
+    std::cout << "threads  queries/s  speedup\n";
+    double single = 0;
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        std::atomic<bool> stop{false};
+        std::atomic<long long> total{0};
+        std::vector<std::thread> workers;
+
+        for (size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]() {
+                point_query query;
+                long long done = 0;
+                long long id = static_cast<long long>(t) * 7919;
+
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    auto reader = pool.reader();
+                    query.id = id++ % rows + 1;
+                    reader->execute_query(query);
+                    ++done;
+                }
+                total += done;
+            });
+        }
+
+        std::this_thread::sleep_for(duration);
+        stop = true;
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+
+        double per_second = static_cast<double>(total) / std::chrono::duration<double>(duration).count();
+        if (threads == 1)
+        {
+            single = per_second;
+        }
+        std::cout << threads << "        " << static_cast<long long>(per_second) << "     " << per_second / single << "x\n";
+    }
+
+    remove_database(name);
+    return 0;
+}
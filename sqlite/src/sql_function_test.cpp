@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sqlite_connect/sqlite_connect.hpp"
+
+struct mean
+{
+    double sum = 0;
+    long n = 0;
+};
+
+// A state that owns memory, so a missed destructor shows up under ASan
+struct joined
+{
+    std::string text;
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        std::cout << "FAIL " << what << "\n";
+        ++failures;
+    }
+}
+
+template <typename Value_T>
+static std::vector<Value_T> column(sqlite_connect::connection &db, const char *sql)
+{
+    std::vector<Value_T> values;
+    for (auto [value] : sqlite_connect::query<Value_T>(db, sql))
+    {
+        values.push_back(value);
+    }
+    return values;
+}
+
+/*
+ * Scalar functions and aggregates registered from C++ callables, with their
+ * conversions, NULLs, errors and aggregates over empty and grouped input.
+ */
+int main()
+{
+    sqlite_connect::connection db;
+
+    db.create_function("clamp", [](double x, double lo, double hi) { return std::clamp(x, lo, hi); });
+    db.create_function("greet", [](std::string_view name) { return "hello " + std::string(name); });
+    db.create_function("twice", [](std::optional<long long> x) { return x ? std::optional(*x * 2) : std::nullopt; });
+    db.create_function("fail", [](long long) -> long long { throw std::runtime_error("fail was called"); });
+    db.create_aggregate("mean", [](mean &m, double x) { m.sum += x; ++m.n; },
+                        [](mean &m) { return m.n ? std::optional(m.sum / m.n) : std::nullopt; });
+    db.create_aggregate("joined", [](joined &j, std::string_view s) { j.text += j.text.empty() ? "" : ","; j.text += s; },
+                        [](joined &j) { return j.text; });
+
+    check(column<double>(db, "SELECT clamp(5, 0, 3)") == std::vector<double>{3}, "clamp converts its arguments");
+    check(column<std::string>(db, "SELECT greet('db')") == std::vector<std::string>{"hello db"}, "greet returns text");
+    check(column<std::optional<long long>>(db, "SELECT twice(21)") == std::vector<std::optional<long long>>{42},
+          "twice doubles a value");
+    check(column<std::optional<long long>>(db, "SELECT twice(NULL)") == std::vector<std::optional<long long>>{std::nullopt},
+          "twice passes NULL through");
+
+    bool threw = false;
+    try
+    {
+        column<long long>(db, "SELECT fail(1)");
+    }
+    catch (sqlite_connect::database_exception const &e)
+    {
+        threw = std::string(e.what()).find("fail was called") != std::string::npos;
+    }
+    check(threw, "an exception becomes the SQL error");
+
+    db.execute_query("CREATE TABLE samples (grp INTEGER, x REAL, name TEXT)");
+    check(column<std::optional<double>>(db, "SELECT mean(x) FROM samples") == std::vector<std::optional<double>>{std::nullopt},
+          "mean over no rows is NULL");
+    check(column<std::string>(db, "SELECT joined(name) FROM samples") == std::vector<std::string>{""},
+          "joined over no rows is empty");
+
+    db.execute_query("INSERT INTO samples VALUES (1, 1.0, 'a'), (1, 2.0, 'b'), (2, 10.0, 'c'), (1, 6.0, 'd')");
+    check(column<std::optional<double>>(db, "SELECT mean(x) FROM samples") == std::vector<std::optional<double>>{4.75},
+          "mean over several rows");
+    check(column<std::optional<double>>(db, "SELECT mean(x) FROM samples GROUP BY grp ORDER BY grp") ==
+              std::vector<std::optional<double>>{3.0, 10.0},
+          "mean per group");
+    // The order of the rows within a group is up to SQLite
+    check(column<long long>(db, "SELECT length(joined(name)) FROM samples GROUP BY grp ORDER BY grp") == std::vector<long long>{5, 1},
+          "joined per group");
+
+    std::cout << (failures == 0 ? "sql_function: ok\n" : "sql_function: failed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+
+#include "async_executor.hpp"
+#include <algorithm>
+
+using namespace sqlite_connect;
+
+namespace sqlite_connect
+{
+
+class async_job
+{
+public:
+    enum class state
+    {
+        QUEUED,
+        RUNNING,
+        DONE
+    };
+
+    std::shared_ptr<iquery> query;
+    async_executor::completion done;
+    async_executor::poster post;
+    async_executor *owner = nullptr;
+
+    std::mutex mutex;
+    state current = state::QUEUED;
+    bool cancelled = false;
+    sqlite3 *running_on = nullptr;
+
+    void complete(std::exception_ptr error)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = state::DONE;
+            running_on = nullptr;
+        }
+
+        if (!done)
+        {
+            return;
+        }
+        if (post)
+        {
+            post([done = std::move(done), error]() { done(error); });
+        }
+        else
+        {
+            done(error);
+        }
+    }
+};
+
+}; // namespace sqlite_connect
+
+namespace
+{
+
+std::exception_ptr cancelled_error()
+{
+    return std::make_exception_ptr(database_exception("Query cancelled"));
+}
+
+// SQLite only clears an interrupt once no statement on the connection is running
+void reset_busy_statements(sqlite3 *db)
+{
+    for (sqlite3_stmt *stmt = sqlite3_next_stmt(db, nullptr); stmt != nullptr; stmt = sqlite3_next_stmt(db, stmt))
+    {
+        if (sqlite3_stmt_busy(stmt))
+        {
+            sqlite3_reset(stmt);
+        }
+    }
+}
+
+} // namespace
+
+async_ticket::async_ticket(std::shared_ptr<async_job> job) : m_job(std::move(job))
+{
+}
+
+bool async_ticket::cancel()
+{
+    if (!m_job)
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_job->mutex);
+        if (m_job->current == async_job::state::DONE)
+        {
+            return false;
+        }
+        m_job->cancelled = true;
+        if (m_job->current == async_job::state::RUNNING)
+        {
+            if (m_job->running_on != nullptr)
+            {
+                sqlite3_interrupt(m_job->running_on);
+            }
+            return true;
+        }
+        // A worker or shutdown() that already took it sees the flag instead
+        if (!m_job->owner->dequeue(m_job))
+        {
+            return true;
+        }
+    }
+    m_job->complete(cancelled_error());
+    return true;
+}
+
+bool async_ticket::is_done() const
+{
+    if (!m_job)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_job->mutex);
+    return m_job->current == async_job::state::DONE;
+}
+
+async_executor::async_executor(std::string name, size_t workers, size_t max_queued, int busy_timeout_ms)
+    : m_max_queued(max_queued == 0 ? 1 : max_queued)
+{
+    for (size_t i = 0; i < (workers == 0 ? 1 : workers); ++i)
+    {
+        auto conn = std::make_shared<connection>(name, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX);
+        if (!conn->is_open())
+        {
+            throw database_exception("Could not open " + name);
+        }
+        sqlite3_busy_timeout(static_cast<sqlite3 *>(*conn), busy_timeout_ms);
+        m_connections.push_back(conn);
+    }
+
+    for (auto &conn : m_connections)
+    {
+        m_workers.emplace_back([this, conn]() { work(*conn); });
+    }
+}
+
+async_executor::~async_executor()
+{
+    shutdown();
+}
+
+void async_executor::work(connection &db)
+{
+    while (true)
+    {
+        std::shared_ptr<async_job> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_not_empty.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty())
+            {
+                return;
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_not_full.notify_one();
+
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            if (job->cancelled)
+            {
+                job->current = async_job::state::DONE;
+            }
+            else
+            {
+                job->current = async_job::state::RUNNING;
+                job->running_on = static_cast<sqlite3 *>(db);
+            }
+        }
+
+        if (job->current == async_job::state::DONE)
+        {
+            job->complete(cancelled_error());
+            continue;
+        }
+
+        std::exception_ptr error;
+        try
+        {
+            db.execute_query(*job->query);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        // No cancel() can interrupt the connection after this, so the next job starts clean
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            job->running_on = nullptr;
+        }
+        reset_busy_statements(static_cast<sqlite3 *>(db));
+        job->complete(error);
+    }
+}
+
+std::shared_ptr<async_job> async_executor::make_job(std::shared_ptr<iquery> query, completion done, poster post)
+{
+    auto job = std::make_shared<async_job>();
+    job->query = std::move(query);
+    job->done = std::move(done);
+    job->post = std::move(post);
+    job->owner = this;
+    return job;
+}
+
+bool async_executor::dequeue(std::shared_ptr<async_job> const &job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = std::find(m_queue.begin(), m_queue.end(), job);
+        if (found == m_queue.end())
+        {
+            return false;
+        }
+        m_queue.erase(found);
+    }
+    m_not_full.notify_one();
+    return true;
+}
+
+void async_executor::enqueue(std::unique_lock<std::mutex> &lock, std::shared_ptr<async_job> job)
+{
+    if (m_stopping)
+    {
+        throw database_exception("The executor is shut down");
+    }
+    m_queue.push_back(std::move(job));
+    lock.unlock();
+    m_not_empty.notify_one();
+}
+
+async_result async_executor::submit(std::shared_ptr<iquery> query)
+{
+    auto promise = std::make_shared<std::promise<void>>();
+    async_result result;
+    result.future = promise->get_future();
+
+    async_ticket ticket = submit(std::move(query), [promise](std::exception_ptr error) {
+        if (error)
+        {
+            promise->set_exception(error);
+        }
+        else
+        {
+            promise->set_value();
+        }
+    });
+    result.ticket = std::move(ticket);
+    return result;
+}
+
+async_ticket async_executor::submit(std::shared_ptr<iquery> query, completion done, poster post)
+{
+    auto job = make_job(std::move(query), std::move(done), std::move(post));
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_not_full.wait(lock, [this]() { return m_stopping || m_queue.size() < m_max_queued; });
+    enqueue(lock, job);
+    return async_ticket(job);
+}
+
+std::optional<async_ticket> async_executor::try_submit(std::shared_ptr<iquery> query, completion done, poster post)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_stopping && m_queue.size() >= m_max_queued)
+    {
+        return std::nullopt;
+    }
+
+    auto job = make_job(std::move(query), std::move(done), std::move(post));
+    enqueue(lock, job);
+    return async_ticket(job);
+}
+
+size_t async_executor::queued() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.size();
+}
+
+void async_executor::shutdown()
+{
+    std::deque<std::shared_ptr<async_job>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping && m_workers.empty())
+        {
+            return;
+        }
+        m_stopping = true;
+        dropped.swap(m_queue);
+    }
+    m_not_empty.notify_all();
+    m_not_full.notify_all();
+
+    for (auto &job : dropped)
+    {
+        job->complete(cancelled_error());
+    }
+    for (auto &worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
@@ -0,0 +1,99 @@
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "connection.hpp"
+#include "iquery.hpp"
+
+namespace sqlite_connect
+{
+
+class async_job;
+
+/*
+ * Cancels a submitted query. A query that is still queued leaves the queue
+ * and completes at once with a "Query cancelled" database_exception; a
+ * running one is interrupted and completes with SQLite's interrupt error.
+ */
+class async_ticket
+{
+private:
+    std::shared_ptr<async_job> m_job;
+
+public:
+    async_ticket() = default;
+    explicit async_ticket(std::shared_ptr<async_job> job);
+
+    // Returns false if the query had already completed
+    bool cancel();
+    bool is_done() const;
+};
+
+struct async_result
+{
+    std::future<void> future;
+    async_ticket ticket;
+};
+
+/*
+ * Runs iquery jobs on worker threads that each own a connection to the
+ * database, so callers never block on SQLite. Jobs wait in a bounded queue:
+ * submit blocks while it is full and try_submit gives up instead.
+ *
+ * Completion is either a std::future or a callback. Without a poster the
+ * callback runs on the worker thread; with one, the worker hands the call to
+ * the poster, e.g. to queue it on the caller's event loop.
+ */
+class async_executor
+{
+public:
+    using completion = std::function<void(std::exception_ptr)>;
+    using poster = std::function<void(std::function<void()>)>;
+
+private:
+    std::vector<std::shared_ptr<connection>> m_connections;
+    std::vector<std::thread> m_workers;
+    std::deque<std::shared_ptr<async_job>> m_queue;
+    size_t m_max_queued;
+    bool m_stopping = false;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_not_empty;
+    std::condition_variable m_not_full;
+
+    void work(connection &db);
+    std::shared_ptr<async_job> make_job(std::shared_ptr<iquery> query, completion done, poster post);
+    void enqueue(std::unique_lock<std::mutex> &lock, std::shared_ptr<async_job> job);
+    // Takes a cancelled job out of the queue, false if it already left
+    bool dequeue(std::shared_ptr<async_job> const &job);
+
+    friend class async_ticket;
+
+public:
+    async_executor(std::string name, size_t workers = 1, size_t max_queued = 1024, int busy_timeout_ms = 5000);
+    virtual ~async_executor();
+
+    async_executor(async_executor &) = delete;
+    async_executor &operator=(async_executor &) = delete;
+
+    async_result submit(std::shared_ptr<iquery> query);
+    async_ticket submit(std::shared_ptr<iquery> query, completion done, poster post = nullptr);
+    std::optional<async_ticket> try_submit(std::shared_ptr<iquery> query, completion done, poster post = nullptr);
+
+    size_t queued() const;
+
+    // Finishes the running jobs, cancels the queued ones and joins the workers
+    void shutdown();
+};
+
+}; // namespace sqlite_connect
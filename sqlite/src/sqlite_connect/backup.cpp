@@ -0,0 +1,206 @@
+
+#include "backup.hpp"
+
+using namespace sqlite_connect;
+
+namespace
+{
+
+std::string pragma_value(connection &db, const char *pragma)
+{
+    sqlite3 *handle = static_cast<sqlite3 *>(db);
+    sqlite3_stmt *stmt = nullptr;
+    int rc = sqlite3_prepare_v2(handle, pragma, -1, &stmt, nullptr);
+    std::string value;
+    if (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0) != nullptr)
+    {
+        value = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    }
+    rc = sqlite3_finalize(stmt);
+    if (database_exception::is_error_code(rc))
+    {
+        throw database_exception(std::string(pragma) + ": " + sqlite3_errmsg(handle));
+    }
+    return value;
+}
+
+// A backup into a WAL database cannot change its page size, and only fails with "readonly database"
+void check_target(connection &memory, connection &disk, std::string const &file)
+{
+    std::string mode = pragma_value(disk, "PRAGMA journal_mode");
+    if (mode != "wal" && mode != "WAL")
+    {
+        return;
+    }
+    std::string memory_size = pragma_value(memory, "PRAGMA page_size");
+    std::string disk_size = pragma_value(disk, "PRAGMA page_size");
+    if (memory_size != disk_size)
+    {
+        throw database_exception(file + " is in WAL mode with page size " + disk_size + " but the memory database uses " +
+                                 memory_size + ", set PRAGMA page_size=" + disk_size +
+                                 " on the memory database before creating tables or take the file out of WAL mode");
+    }
+}
+
+} // namespace
+
+void sqlite_connect::backup_database(connection &from, connection &to, int pages_per_step,
+                                     std::chrono::milliseconds pause, const char *from_schema, const char *to_schema)
+{
+    sqlite3 *source = static_cast<sqlite3 *>(from);
+    sqlite3 *destination = static_cast<sqlite3 *>(to);
+
+    sqlite3_backup *backup = sqlite3_backup_init(destination, to_schema, source, from_schema);
+    if (backup == nullptr)
+    {
+        throw database_exception(sqlite3_errmsg(destination));
+    }
+
+    int rc = SQLITE_OK;
+    do
+    {
+        rc = sqlite3_backup_step(backup, pages_per_step);
+        if ((rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) && pause.count() > 0)
+        {
+            std::this_thread::sleep_for(pause);
+        }
+    } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+    // finish reports the error of the failed step, if any
+    rc = sqlite3_backup_finish(backup);
+    if (database_exception::is_error_code(rc))
+    {
+        throw database_exception(sqlite3_errmsg(destination));
+    }
+}
+
+std::shared_ptr<connection> sqlite_connect::load_into_memory(std::string const &file)
+{
+    connection disk(file, SQLITE_OPEN_READONLY);
+    if (!disk.is_open())
+    {
+        throw database_exception("Could not open " + file);
+    }
+
+    auto memory = std::make_shared<connection>(":memory:");
+    backup_database(disk, *memory);
+    return memory;
+}
+
+background_checkpoint::background_checkpoint(std::shared_ptr<connection> memory, std::string file,
+                                             std::chrono::milliseconds interval, int pages_per_step,
+                                             std::chrono::milliseconds step_pause)
+    : m_memory(std::move(memory)), m_file(std::move(file)), m_interval(interval),
+      m_pages_per_step(pages_per_step == 0 ? 1 : pages_per_step), m_step_pause(step_pause)
+{
+    if (!m_memory || !m_memory->is_open())
+    {
+        throw database_exception("Database is not open");
+    }
+    m_saved_changes = sqlite3_total_changes(static_cast<sqlite3 *>(*m_memory));
+
+    // Without CREATE a file that does not exist yet is left to the first copy
+    connection disk(m_file, SQLITE_OPEN_READWRITE);
+    if (disk.is_open())
+    {
+        check_target(*m_memory, disk, m_file);
+    }
+    m_thread = std::thread([this]() { run(); });
+}
+
+background_checkpoint::~background_checkpoint()
+{
+    stop();
+}
+
+void background_checkpoint::checkpoint_now()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_forced = true;
+    }
+    m_wake.notify_one();
+}
+
+void background_checkpoint::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+size_t background_checkpoint::checkpoints() const
+{
+    return m_checkpoints.load();
+}
+
+std::string background_checkpoint::last_error()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_last_error;
+}
+
+void background_checkpoint::run()
+{
+    while (true)
+    {
+        bool stopping, forced;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait_for(lock, m_interval, [this]() { return m_stopping || m_forced; });
+            stopping = m_stopping;
+            forced = m_forced;
+            m_forced = false;
+        }
+
+        checkpoint(forced);
+        if (stopping)
+        {
+            return;
+        }
+    }
+}
+
+void background_checkpoint::checkpoint(bool force)
+{
+    // total_changes counts the rows changed through the memory connection, from any thread
+    int changes = sqlite3_total_changes(static_cast<sqlite3 *>(*m_memory));
+    if (!force && changes == m_saved_changes)
+    {
+        return;
+    }
+
+    try
+    {
+        connection disk(m_file);
+        if (!disk.is_open())
+        {
+            throw database_exception("Could not open " + m_file);
+        }
+        // VACUUM can change the memory database's page size after construction
+        check_target(*m_memory, disk, m_file);
+
+        // The step that finishes a backup commits it, and syncing the file
+        // then would hold the memory database's lock. Stepping into a private
+        // copy first keeps the disk write away from it.
+        connection staging(":memory:");
+        backup_database(*m_memory, staging, m_pages_per_step, m_step_pause);
+        backup_database(staging, disk);
+
+        m_saved_changes = changes;
+        ++m_checkpoints;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_last_error.clear();
+    }
+    catch (database_exception const &e)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_last_error = e.what();
+    }
+}
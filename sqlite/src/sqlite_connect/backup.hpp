@@ -0,0 +1,88 @@
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "connection.hpp"
+
+namespace sqlite_connect
+{
+
+/*
+ * Copies the database from into to with sqlite3_backup, pages_per_step
+ * pages at a time (-1 copies everything in one step). The source is only
+ * locked during a step, so pausing between steps lets other users of it
+ * run. Steps that find either side busy or locked are retried after the
+ * pause.
+ */
+void backup_database(connection &from, connection &to, int pages_per_step = -1,
+                     std::chrono::milliseconds pause = std::chrono::milliseconds(0),
+                     const char *from_schema = "main", const char *to_schema = "main");
+
+// A new in-memory connection holding a copy of the database file
+std::shared_ptr<connection> load_into_memory(std::string const &file);
+
+/*
+ * Writes an in-memory database back to a file every interval, from its own
+ * thread. The copy goes in steps of pages_per_step pages with step_pause in
+ * between, so queries on the memory connection wait for at most one step.
+ * The file is replaced in a single transaction on it, so readers of the
+ * file never see a half-written copy. A copy is only made when rows changed
+ * since the last one (schema changes alone are not noticed, use
+ * checkpoint_now), and stop() makes a final one.
+ *
+ * Backup cannot change the page size of a WAL database, so an existing
+ * file in WAL mode must have the page size of the memory database, or the
+ * constructor throws.
+ *
+ * The memory connection must be in serialized threading mode, the default.
+ */
+class background_checkpoint
+{
+private:
+    std::shared_ptr<connection> m_memory;
+    std::string m_file;
+    std::chrono::milliseconds m_interval;
+    int m_pages_per_step;
+    std::chrono::milliseconds m_step_pause;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+    bool m_forced = false;
+    std::string m_last_error;
+    int m_saved_changes = -1;
+
+    std::atomic<size_t> m_checkpoints{0};
+    std::thread m_thread;
+
+    void run();
+    void checkpoint(bool force);
+
+public:
+    background_checkpoint(std::shared_ptr<connection> memory, std::string file,
+                          std::chrono::milliseconds interval = std::chrono::milliseconds(60000),
+                          int pages_per_step = 64,
+                          std::chrono::milliseconds step_pause = std::chrono::milliseconds(1));
+    virtual ~background_checkpoint();
+
+    background_checkpoint(background_checkpoint &) = delete;
+    background_checkpoint &operator=(background_checkpoint &) = delete;
+
+    // Asks for a copy now, even without changed rows
+    void checkpoint_now();
+
+    // Makes a last copy if rows changed and stops the thread
+    void stop();
+
+    size_t checkpoints() const;
+    // What the last failed copy threw, empty once a copy succeeds
+    std::string last_error();
+};
+
+}; // namespace sqlite_connect
@@ -0,0 +1,257 @@
+
+#include "blob_streambuf.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace sqlite_connect;
+
+blob_streambuf::blob_streambuf(connection &db, const char *table, const char *column, sqlite3_int64 row,
+                               bool writable, size_t buffer_size, const char *schema)
+    : m_db(static_cast<sqlite3 *>(db)), m_writable(writable), m_buffer(buffer_size == 0 ? 1 : buffer_size)
+{
+    int rc = sqlite3_blob_open(m_db, schema, table, column, row, writable ? 1 : 0, &m_blob);
+    if (database_exception::is_error_code(rc))
+    {
+        // The handle is allocated even on failure
+        sqlite3_blob_close(m_blob);
+        throw database_exception(sqlite3_errmsg(m_db));
+    }
+    m_size = sqlite3_blob_bytes(m_blob);
+}
+
+blob_streambuf::~blob_streambuf()
+{
+    try
+    {
+        flush_put();
+    }
+    catch (database_exception const &)
+    {
+    }
+    sqlite3_blob_close(m_blob);
+}
+
+std::streamoff blob_streambuf::size() const
+{
+    return m_size;
+}
+
+void blob_streambuf::reopen(sqlite3_int64 row)
+{
+    flush_put();
+    drop_areas(0);
+
+    int rc = sqlite3_blob_reopen(m_blob, row);
+    if (database_exception::is_error_code(rc))
+    {
+        m_size = 0;
+        throw database_exception(sqlite3_errmsg(m_db));
+    }
+    m_size = sqlite3_blob_bytes(m_blob);
+}
+
+std::streamoff blob_streambuf::position() const
+{
+    if (gptr() != nullptr)
+    {
+        return m_offset + (gptr() - eback());
+    }
+    if (pbase() != nullptr)
+    {
+        return m_offset + (pptr() - pbase());
+    }
+    return m_offset;
+}
+
+bool blob_streambuf::flush_put()
+{
+    if (pbase() == nullptr)
+    {
+        return false;
+    }
+    std::streamsize pending = pptr() - pbase();
+    std::streamoff offset = m_offset;
+    // Drop the area first so a failed write is not retried by the destructor
+    drop_areas(offset + pending);
+    write_at(m_buffer.data(), pending, offset);
+    return true;
+}
+
+void blob_streambuf::drop_areas(std::streamoff offset)
+{
+    setg(nullptr, nullptr, nullptr);
+    setp(nullptr, nullptr);
+    m_offset = offset;
+}
+
+void blob_streambuf::read_at(char *into, std::streamsize count, std::streamoff offset)
+{
+    database_exception::throw_on_error(sqlite3_blob_read(m_blob, into, static_cast<int>(count), static_cast<int>(offset)));
+}
+
+void blob_streambuf::write_at(const char *from, std::streamsize count, std::streamoff offset)
+{
+    if (count > 0)
+    {
+        database_exception::throw_on_error(sqlite3_blob_write(m_blob, from, static_cast<int>(count), static_cast<int>(offset)));
+    }
+}
+
+blob_streambuf::int_type blob_streambuf::underflow()
+{
+    std::streamoff pos = position();
+    flush_put();
+    drop_areas(pos);
+    if (pos >= m_size)
+    {
+        return traits_type::eof();
+    }
+
+    std::streamsize count = std::min<std::streamoff>(m_buffer.size(), m_size - pos);
+    read_at(m_buffer.data(), count, pos);
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + count);
+    return traits_type::to_int_type(*gptr());
+}
+
+blob_streambuf::int_type blob_streambuf::overflow(int_type c)
+{
+    if (!m_writable)
+    {
+        return traits_type::eof();
+    }
+
+    std::streamoff pos = position();
+    flush_put();
+    drop_areas(pos);
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        return traits_type::not_eof(c);
+    }
+    if (pos >= m_size)
+    {
+        return traits_type::eof();
+    }
+
+    std::streamsize room = std::min<std::streamoff>(m_buffer.size(), m_size - pos);
+    setp(m_buffer.data(), m_buffer.data() + room);
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+}
+
+int blob_streambuf::sync()
+{
+    flush_put();
+    return 0;
+}
+
+std::streamsize blob_streambuf::xsgetn(char *s, std::streamsize n)
+{
+    std::streamsize done = 0;
+    while (done < n)
+    {
+        std::streamsize buffered = egptr() - gptr();
+        if (buffered > 0)
+        {
+            std::streamsize count = std::min(buffered, n - done);
+            std::memcpy(s + done, gptr(), count);
+            gbump(static_cast<int>(count));
+            done += count;
+            continue;
+        }
+
+        // Reads of at least a whole buffer go straight into the caller's memory
+        if (n - done >= static_cast<std::streamsize>(m_buffer.size()))
+        {
+            std::streamoff pos = position();
+            flush_put();
+            drop_areas(pos);
+            std::streamsize count = std::min<std::streamoff>(n - done, m_size - pos);
+            if (count <= 0)
+            {
+                break;
+            }
+            read_at(s + done, count, pos);
+            m_offset = pos + count;
+            done += count;
+            continue;
+        }
+
+        if (traits_type::eq_int_type(underflow(), traits_type::eof()))
+        {
+            break;
+        }
+    }
+    return done;
+}
+
+std::streamsize blob_streambuf::xsputn(const char *s, std::streamsize n)
+{
+    if (!m_writable)
+    {
+        return 0;
+    }
+
+    std::streamsize done = 0;
+    while (done < n)
+    {
+        std::streamsize room = epptr() - pptr();
+        if (room > 0)
+        {
+            std::streamsize count = std::min(room, n - done);
+            std::memcpy(pptr(), s + done, count);
+            pbump(static_cast<int>(count));
+            done += count;
+            continue;
+        }
+
+        if (n - done >= static_cast<std::streamsize>(m_buffer.size()))
+        {
+            std::streamoff pos = position();
+            flush_put();
+            drop_areas(pos);
+            std::streamsize count = std::min<std::streamoff>(n - done, m_size - pos);
+            if (count <= 0)
+            {
+                break;
+            }
+            write_at(s + done, count, pos);
+            m_offset = pos + count;
+            done += count;
+            continue;
+        }
+
+        if (traits_type::eq_int_type(overflow(traits_type::to_int_type(s[done])), traits_type::eof()))
+        {
+            break;
+        }
+        ++done;
+    }
+    return done;
+}
+
+blob_streambuf::pos_type blob_streambuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode)
+{
+    std::streamoff base = dir == std::ios_base::beg ? 0 : dir == std::ios_base::cur ? position() : m_size;
+    std::streamoff target = base + off;
+    if (target < 0 || target > m_size)
+    {
+        return pos_type(off_type(-1));
+    }
+
+    // Seeking within what is already read keeps the buffer
+    if (gptr() != nullptr && target >= m_offset && target < m_offset + (egptr() - eback()))
+    {
+        setg(eback(), eback() + (target - m_offset), egptr());
+        return pos_type(target);
+    }
+
+    flush_put();
+    drop_areas(target);
+    return pos_type(target);
+}
+
+blob_streambuf::pos_type blob_streambuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
@@ -0,0 +1,63 @@
+
+#pragma once
+
+#include <cstdint>
+#include <streambuf>
+#include <vector>
+#include "connection.hpp"
+#include "sqlite3.h"
+
+namespace sqlite_connect
+{
+
+/*
+ * Streams one BLOB cell through sqlite3_blob_read/write, a buffer at a time,
+ * so a large value never has to be held in memory. Wrap it in std::istream
+ * or std::ostream. A blob cannot change its size this way: to write one,
+ * insert it as zeroblob(size) first and then fill it in.
+ *
+ * reopen() moves the handle to another row of the same column, which is much
+ * cheaper than opening a new one. Any change to the row from outside the
+ * handle aborts it, and further reads or writes throw database_exception.
+ */
+class blob_streambuf : public std::streambuf
+{
+private:
+    sqlite3 *m_db;
+    sqlite3_blob *m_blob = nullptr;
+    bool m_writable;
+    std::vector<char> m_buffer;
+    // Offset in the blob of the start of the get or put area
+    std::streamoff m_offset = 0;
+    std::streamoff m_size = 0;
+
+    std::streamoff position() const;
+    bool flush_put();
+    void drop_areas(std::streamoff offset);
+    void read_at(char *into, std::streamsize count, std::streamoff offset);
+    void write_at(const char *from, std::streamsize count, std::streamoff offset);
+
+protected:
+    int_type underflow() override;
+    int_type overflow(int_type c) override;
+    int sync() override;
+    std::streamsize xsgetn(char *s, std::streamsize n) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+public:
+    blob_streambuf(connection &db, const char *table, const char *column, sqlite3_int64 row,
+                   bool writable = false, size_t buffer_size = 64 * 1024, const char *schema = "main");
+    virtual ~blob_streambuf();
+
+    blob_streambuf(blob_streambuf &) = delete;
+    blob_streambuf &operator=(blob_streambuf &) = delete;
+
+    // Flushes pending writes and points the handle at another row
+    void reopen(sqlite3_int64 row);
+
+    std::streamoff size() const;
+};
+
+}; // namespace sqlite_connect
@@ -0,0 +1,129 @@
+
+#include "bulk_insert.hpp"
+
+using namespace sqlite_connect;
+
+namespace
+{
+
+// Savepoints instead of BEGIN/COMMIT so an insert nests inside the caller's transaction
+const char *savepoint_sql = "SAVEPOINT sqlite_connect_bulk_insert";
+const char *release_sql = "RELEASE SAVEPOINT sqlite_connect_bulk_insert";
+const char *rollback_sql = "ROLLBACK TO SAVEPOINT sqlite_connect_bulk_insert";
+
+std::string quote_identifier(std::string const &name)
+{
+    std::string quoted = "\"";
+    for (char c : name)
+    {
+        quoted += c;
+        if (c == '"')
+        {
+            quoted += '"';
+        }
+    }
+    quoted += '"';
+    return quoted;
+}
+
+} // namespace
+
+double bulk_insert::result::rows_per_second() const
+{
+    return seconds > 0 ? rows / seconds : 0;
+}
+
+bulk_insert::bulk_insert(connection &db, std::string table, std::vector<std::string> columns, size_t commit_every)
+    : m_db(db), m_table(std::move(table)), m_columns(std::move(columns)), m_commit_every(commit_every)
+{
+    if (m_columns.empty())
+    {
+        throw database_exception("bulk_insert needs at least one column");
+    }
+
+    // The runtime limit, SQLITE_MAX_VARIABLE_NUMBER unless lowered
+    int variables = sqlite3_limit(static_cast<sqlite3 *>(m_db), SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+    m_rows_per_statement = static_cast<size_t>(variables) / m_columns.size();
+    if (m_rows_per_statement == 0)
+    {
+        throw database_exception("bulk_insert: too many columns for one statement");
+    }
+}
+
+size_t bulk_insert::rows_per_statement() const
+{
+    return m_rows_per_statement;
+}
+
+std::string bulk_insert::build_sql(size_t rows) const
+{
+    std::string row = "(?";
+    for (size_t i = 1; i < m_columns.size(); ++i)
+    {
+        row += ",?";
+    }
+    row += ")";
+
+    std::string sql = "INSERT INTO " + quote_identifier(m_table) + " (";
+    for (size_t i = 0; i < m_columns.size(); ++i)
+    {
+        sql += (i == 0 ? "" : ", ") + quote_identifier(m_columns[i]);
+    }
+    sql += ") VALUES ";
+
+    sql.reserve(sql.size() + rows * (row.size() + 1));
+    for (size_t i = 0; i < rows; ++i)
+    {
+        if (i > 0)
+        {
+            sql += ',';
+        }
+        sql += row;
+    }
+    return sql;
+}
+
+prepared_statement &bulk_insert::statement_for(size_t rows, prepared_statement &tail)
+{
+    if (rows == m_rows_per_statement)
+    {
+        if (!m_full_prepared)
+        {
+            m_full.prepare(static_cast<sqlite3 *>(m_db), build_sql(rows).c_str());
+            m_full_prepared = true;
+        }
+        m_full.set_profiler(m_db.profiler());
+        return m_full;
+    }
+
+    // Only the last chunk of an insert is short
+    tail.prepare(static_cast<sqlite3 *>(m_db), build_sql(rows).c_str());
+    tail.set_profiler(m_db.profiler());
+    return tail;
+}
+
+void bulk_insert::begin()
+{
+    m_db.execute_query(savepoint_sql);
+}
+
+void bulk_insert::commit()
+{
+    m_db.execute_query(release_sql);
+}
+
+void bulk_insert::rollback()
+{
+    // Called while an exception is in flight, so a failed rollback is not reported
+    sqlite3 *db = static_cast<sqlite3 *>(m_db);
+    if (m_full_prepared)
+    {
+        sqlite3_reset(m_full);
+    }
+    // Some errors make SQLite roll back the whole transaction by itself
+    if (!sqlite3_get_autocommit(db))
+    {
+        sqlite3_exec(db, rollback_sql, nullptr, nullptr, nullptr);
+        sqlite3_exec(db, release_sql, nullptr, nullptr, nullptr);
+    }
+}
@@ -0,0 +1,141 @@
+
+#pragma once
+
+#include <chrono>
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "connection.hpp"
+#include "prepared_statement.hpp"
+
+namespace sqlite_connect
+{
+
+/*
+ * Loads many rows into one table with multi-row
+ * INSERT INTO t (a, b) VALUES (?, ?), (?, ?), ... statements, each with as
+ * many rows as the connection's variable limit allows. The statement is
+ * prepared once and reused for every full chunk. Rows are inserted inside
+ * savepoints that are released every commit_every rows (rounded up to a
+ * whole chunk); if a chunk fails, the open savepoint is rolled back and
+ * earlier releases stay. On its own that commits every commit_every rows.
+ * Inside a caller's transaction or savepoint the rows join it instead, and
+ * a failure leaves the caller's transaction open.
+ */
+class bulk_insert
+{
+public:
+    struct result
+    {
+        size_t rows = 0;
+        double seconds = 0;
+
+        double rows_per_second() const;
+    };
+
+private:
+    connection &m_db;
+    std::string m_table;
+    std::vector<std::string> m_columns;
+    size_t m_commit_every;
+    size_t m_rows_per_statement;
+    prepared_statement m_full;
+    bool m_full_prepared = false;
+
+    std::string build_sql(size_t rows) const;
+    prepared_statement &statement_for(size_t rows, prepared_statement &tail);
+    void begin();
+    void commit();
+    void rollback();
+
+    template <typename Tuple_T, size_t... I>
+    static void bind_row(prepared_statement &stmt, size_t first, Tuple_T const &row, std::index_sequence<I...>)
+    {
+        // The row may be a temporary tuple, so SQLite keeps its own copy of text
+        (stmt.bind_value(first + I, std::get<I>(row), lifetime::TRANSIENT), ...);
+    }
+
+public:
+    bulk_insert(connection &db, std::string table, std::vector<std::string> columns, size_t commit_every = 100000);
+
+    size_t rows_per_statement() const;
+
+    /*
+     * Inserts a forward range of tuples, one element per column.
+     */
+    template <typename Range_T>
+    result insert(Range_T const &rows)
+    {
+        return insert(rows, [](auto const &row) -> auto const & { return row; });
+    }
+
+    /*
+     * Inserts a forward range of structs, project(row) returns a tuple of
+     * the column values, e.g. std::tie(row.x, row.y).
+     */
+    template <typename Range_T, typename Project_T>
+    result insert(Range_T const &rows, Project_T &&project)
+    {
+        result stats;
+        auto start = std::chrono::steady_clock::now();
+        prepared_statement tail;
+        size_t uncommitted = 0;
+
+        auto it = std::begin(rows);
+        auto end = std::end(rows);
+
+        begin();
+        try
+        {
+            while (it != end)
+            {
+                auto chunk = it;
+                size_t count = 0;
+                while (it != end && count < m_rows_per_statement)
+                {
+                    ++it;
+                    ++count;
+                }
+
+                prepared_statement &stmt = statement_for(count, tail);
+                size_t index = 1;
+                for (; chunk != it; ++chunk)
+                {
+                    decltype(auto) row = project(*chunk);
+                    using row_t = std::decay_t<decltype(row)>;
+                    if (std::tuple_size<row_t>::value != m_columns.size())
+                    {
+                        throw database_exception("bulk_insert: row does not match the columns of " + m_table);
+                    }
+                    bind_row(stmt, index, row, std::make_index_sequence<std::tuple_size<row_t>::value>{});
+                    index += m_columns.size();
+                }
+                stmt.step();
+                stmt.reset();
+
+                stats.rows += count;
+                uncommitted += count;
+                if (uncommitted >= m_commit_every)
+                {
+                    commit();
+                    begin();
+                    uncommitted = 0;
+                }
+            }
+            commit();
+        }
+        catch (...)
+        {
+            rollback();
+            throw;
+        }
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+};
+
+}; // namespace sqlite_connect
@@ -0,0 +1,192 @@
+
+#include "columnar_reader.hpp"
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <string>
+
+using namespace sqlite_connect;
+
+bool column_chunk::is_null(size_t row) const
+{
+    return (nulls[row / 64] >> (row % 64)) & 1;
+}
+
+std::string_view column_chunk::text(size_t row) const
+{
+    return std::string_view(reinterpret_cast<const char *>(arena.data()) + offsets[row], offsets[row + 1] - offsets[row]);
+}
+
+std::span<const std::byte> column_chunk::blob(size_t row) const
+{
+    return std::span<const std::byte>(arena.data() + offsets[row], offsets[row + 1] - offsets[row]);
+}
+
+columnar_reader::columnar_reader(std::shared_ptr<prepared_statement> stmt, std::vector<column_type> types, size_t chunk_rows)
+    : m_stmt(std::move(stmt)), m_types(std::move(types)), m_chunk_rows(chunk_rows == 0 ? 1 : chunk_rows)
+{
+    if (static_cast<size_t>(sqlite3_column_count(*m_stmt)) < m_types.size())
+    {
+        throw database_exception("Query returns fewer columns than requested");
+    }
+}
+
+columnar_reader::columnar_reader(connection &db, const char *sql, size_t chunk_rows)
+    : m_stmt(db.prepare(sql)), m_chunk_rows(chunk_rows == 0 ? 1 : chunk_rows)
+{
+    int count = sqlite3_column_count(*m_stmt);
+    for (int i = 0; i < count; ++i)
+    {
+        // Expressions such as count(*) have no declared type and no-type columns take any value
+        const char *declared = sqlite3_column_decltype(*m_stmt, i);
+        if (declared == nullptr || *declared == '\0')
+        {
+            throw database_exception(std::string("columnar_reader: column ") + sqlite3_column_name(*m_stmt, i) +
+                                     " has no declared type, pass the column types");
+        }
+        m_types.push_back(type_for_declaration(declared));
+    }
+}
+
+columnar_reader::~columnar_reader()
+{
+    // Records a read stopped before the last chunk
+    try
+    {
+        m_stmt->reset();
+    }
+    catch (database_exception const &)
+    {
+        // The failed step already threw this error
+    }
+}
+
+column_type columnar_reader::type_for_declaration(const char *declared)
+{
+    if (declared == nullptr)
+    {
+        return column_type::BLOB;
+    }
+
+    std::string upper(declared);
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return std::toupper(c); });
+
+    if (upper.find("INT") != std::string::npos)
+    {
+        return column_type::INTEGER;
+    }
+    if (upper.find("CHAR") != std::string::npos || upper.find("CLOB") != std::string::npos || upper.find("TEXT") != std::string::npos)
+    {
+        return column_type::TEXT;
+    }
+    if (upper.empty() || upper.find("BLOB") != std::string::npos)
+    {
+        return column_type::BLOB;
+    }
+    // REAL affinity, and NUMERIC affinity such as DECIMAL(10,2), which can hold fractions
+    return column_type::REAL;
+}
+
+std::vector<column_type> const &columnar_reader::types() const
+{
+    return m_types;
+}
+
+void columnar_reader::prepare_chunk(result_chunk &chunk) const
+{
+    chunk.rows = 0;
+    chunk.columns.resize(m_types.size());
+
+    for (size_t i = 0; i < m_types.size(); ++i)
+    {
+        column_chunk &column = chunk.columns[i];
+        column.type = m_types[i];
+        column.integers.clear();
+        column.reals.clear();
+        column.offsets.clear();
+        column.arena.clear();
+        column.nulls.assign((m_chunk_rows + 63) / 64, 0);
+
+        switch (column.type)
+        {
+        case column_type::INTEGER:
+            column.integers.reserve(m_chunk_rows);
+            break;
+        case column_type::REAL:
+            column.reals.reserve(m_chunk_rows);
+            break;
+        case column_type::TEXT:
+        case column_type::BLOB:
+            column.offsets.reserve(m_chunk_rows + 1);
+            column.offsets.push_back(0);
+            break;
+        }
+    }
+}
+
+void columnar_reader::append_row(result_chunk &chunk, size_t row)
+{
+    sqlite3_stmt *stmt = *m_stmt;
+
+    for (size_t i = 0; i < m_types.size(); ++i)
+    {
+        column_chunk &column = chunk.columns[i];
+        int index = static_cast<int>(i);
+        bool null = sqlite3_column_type(stmt, index) == SQLITE_NULL;
+        if (null)
+        {
+            column.nulls[row / 64] |= uint64_t(1) << (row % 64);
+        }
+
+        switch (column.type)
+        {
+        case column_type::INTEGER:
+            column.integers.push_back(null ? 0 : sqlite3_column_int64(stmt, index));
+            break;
+        case column_type::REAL:
+            column.reals.push_back(null ? 0.0 : sqlite3_column_double(stmt, index));
+            break;
+        case column_type::TEXT:
+        case column_type::BLOB:
+        {
+            const void *data = nullptr;
+            if (!null)
+            {
+                data = column.type == column_type::TEXT
+                           ? static_cast<const void *>(sqlite3_column_text(stmt, index))
+                           : sqlite3_column_blob(stmt, index);
+            }
+            size_t size = data == nullptr ? 0 : static_cast<size_t>(sqlite3_column_bytes(stmt, index));
+            if (column.arena.size() + size > std::numeric_limits<uint32_t>::max())
+            {
+                throw database_exception("Chunk arena is over 4GB, use smaller chunks");
+            }
+            const std::byte *bytes = static_cast<const std::byte *>(data);
+            column.arena.insert(column.arena.end(), bytes, bytes + size);
+            column.offsets.push_back(static_cast<uint32_t>(column.arena.size()));
+            break;
+        }
+        }
+    }
+}
+
+bool columnar_reader::next(result_chunk &chunk)
+{
+    prepare_chunk(chunk);
+    if (m_done)
+    {
+        return false;
+    }
+
+    while (chunk.rows < m_chunk_rows)
+    {
+        if (!m_stmt->step())
+        {
+            m_done = true;
+            break;
+        }
+        append_row(chunk, chunk.rows);
+        ++chunk.rows;
+    }
+    return chunk.rows > 0;
+}
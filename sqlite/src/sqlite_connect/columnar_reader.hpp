@@ -0,0 +1,90 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "connection.hpp"
+#include "prepared_statement.hpp"
+
+namespace sqlite_connect
+{
+
+enum class column_type
+{
+    INTEGER,
+    REAL,
+    TEXT,
+    BLOB
+};
+
+/*
+ * One column of a chunk. Only the storage of its type is used: integers or
+ * reals hold one value per row, text and blobs are packed into the arena
+ * with offsets[row]..offsets[row + 1] marking each value. A set bit in the
+ * null bitmap marks a NULL, whose value slot is zero or empty.
+ */
+struct column_chunk
+{
+    column_type type = column_type::INTEGER;
+    std::vector<int64_t> integers;
+    std::vector<double> reals;
+    std::vector<uint32_t> offsets;
+    std::vector<std::byte> arena;
+    std::vector<uint64_t> nulls;
+
+    bool is_null(size_t row) const;
+    std::string_view text(size_t row) const;
+    std::span<const std::byte> blob(size_t row) const;
+};
+
+struct result_chunk
+{
+    size_t rows = 0;
+    std::vector<column_chunk> columns;
+};
+
+/*
+ * Streams the rows of a statement into column-major chunks of up to
+ * chunk_rows rows. Passing the same result_chunk to every next() call reuses
+ * its buffers, so once the first chunk has sized them no row allocates.
+ */
+class columnar_reader
+{
+private:
+    std::shared_ptr<prepared_statement> m_stmt;
+    std::vector<column_type> m_types;
+    size_t m_chunk_rows;
+    bool m_done = false;
+
+    void prepare_chunk(result_chunk &chunk) const;
+    void append_row(result_chunk &chunk, size_t row);
+
+public:
+    columnar_reader(std::shared_ptr<prepared_statement> stmt, std::vector<column_type> types, size_t chunk_rows = 65536);
+
+    /*
+     * Column types are taken from the declared types of the result columns.
+     * Throws for a column without one, an expression or a column declared
+     * without a type, as its values can be of any type.
+     */
+    columnar_reader(connection &db, const char *sql, size_t chunk_rows = 65536);
+
+    virtual ~columnar_reader();
+
+    columnar_reader(columnar_reader &) = delete;
+    columnar_reader &operator=(columnar_reader &) = delete;
+
+    // Fills chunk with the next rows, returns false once there are none left
+    bool next(result_chunk &chunk);
+
+    std::vector<column_type> const &types() const;
+
+    // SQLite's affinity rules applied to a declared column type
+    static column_type type_for_declaration(const char *declared);
+};
+
+}; // namespace sqlite_connect
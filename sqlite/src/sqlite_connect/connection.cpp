@@ -1,5 +1,6 @@
 
 #include "connection.hpp"
+#include <chrono>
 #include <iostream>
 
 using namespace sqlite_connect;
@@ -9,27 +10,51 @@ connection::connection(std::string name) : m_db_name(name)
     m_is_open = (sqlite3_open(m_db_name.c_str(), &m_db) == SQLITE_OK);
 }
 
-connection::~connection()
+connection::connection(std::string name, int flags) : m_db_name(name)
 {
+    m_is_open = (sqlite3_open_v2(m_db_name.c_str(), &m_db, flags, nullptr) == SQLITE_OK);
+}
+
+connection::connection(std::string name, connection_options const &options) : m_db_name(name)
+{
+    m_is_open = (sqlite3_open_v2(m_db_name.c_str(), &m_db, options.open_flags(), nullptr) == SQLITE_OK);
     if (m_is_open)
     {
-        sqlite3_close_v2(m_db);
+        try
+        {
+            options.apply(m_db);
+        }
+        catch (database_exception const &)
+        {
+            sqlite3_close_v2(m_db);
+            throw;
+        }
     }
 }
 
+connection::~connection()
+{
+    m_statements.clear();
+    // sqlite3_open allocates a handle even when it fails, and closing null is a no-op
+    sqlite3_close_v2(m_db);
+}
+
 void connection::execute_query(const char *query)
 {
     char *err = nullptr;
+    auto start = m_profiler ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
     int rc = sqlite3_exec(m_db, query, nullptr, nullptr, &err);
 
+    if (m_profiler)
+    {
+        m_profiler->record(query, std::chrono::steady_clock::now() - start, 0, nullptr);
+    }
+
     if (database_exception::is_error_code(rc))
     {
-        std::string err_msg = sqlite3_errmsg(m_db);
-        if (err != nullptr)
-        {
-            err_msg += ": ";
-            err_msg += err;
-        }
+        // err holds the same text as sqlite3_errmsg
+        std::string err_msg = err != nullptr ? err : sqlite3_errmsg(m_db);
+        sqlite3_free(err);
         throw database_exception(err_msg);
     }
 }
@@ -46,26 +71,36 @@ void connection::execute_query(iquery &query)
         throw database_exception("Database is not open");
     }
 
-    try
-    {
-        if (query.is_cached()) {
-            auto cached = query.cache();
-            cached->reset();
-            query.execute(cached);
-        } else {
-            auto prepared = std::make_shared<prepared_statement>();
-            prepared->prepare(m_db, query.sql());
-            query.execute(prepared);
-            query.cache(prepared);
-        }
-    }
-    catch (database_exception const &e)
+    // prepare(), step() and reset() already report sqlite3_errmsg
+    auto stmt = m_statements.acquire(m_db, query.sql());
+    stmt->set_profiler(m_profiler);
+    query.execute(stmt);
+}
+
+std::shared_ptr<prepared_statement> connection::prepare(const char *sql)
+{
+    if (!m_is_open)
     {
-        std::string new_err = e.what();
-        new_err += ": ";
-        new_err += sqlite3_errmsg(m_db);
-        throw database_exception(new_err);
+        throw database_exception("Database is not open");
     }
+    auto stmt = m_statements.acquire(m_db, sql);
+    stmt->set_profiler(m_profiler);
+    return stmt;
+}
+
+statement_cache &connection::statements()
+{
+    return m_statements;
+}
+
+void connection::set_profiler(query_profiler *profiler)
+{
+    m_profiler = profiler;
+}
+
+query_profiler *connection::profiler() const
+{
+    return m_profiler;
 }
 
 bool connection::is_open() const
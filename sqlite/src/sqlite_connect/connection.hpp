@@ -3,7 +3,12 @@
 
 #include <string>
 #include <memory>
+#include "connection_options.hpp"
+#include "database_exception.hpp"
 #include "iquery.hpp"
+#include "query_profiler.hpp"
+#include "sql_function.hpp"
+#include "statement_cache.hpp"
 #include "sqlite3.h"
 
 namespace sqlite_connect
@@ -15,9 +20,14 @@ private:
     std::string m_db_name;
     sqlite3 *m_db = nullptr;
     bool m_is_open = false;
+    statement_cache m_statements;
+    query_profiler *m_profiler = nullptr;
 
 public:
     explicit connection(std::string name = ":memory:");
+    connection(std::string name, int flags);
+    // Opens with the options' flags and applies its settings, throws if one fails
+    connection(std::string name, connection_options const &options);
     virtual ~connection();
 
     connection(connection &) = delete;
@@ -29,9 +39,79 @@ public:
     void execute_query(std::shared_ptr<iquery> query);
     void execute_query(iquery &query);
     void execute_query(const char *query);
+
+    // A cached statement for sql, reset and with its bindings cleared
+    std::shared_ptr<prepared_statement> prepare(const char *sql);
+    statement_cache &statements();
+
+    /*
+     * Records into profiler every execution of a statement from prepare()
+     * or execute_query, and every execute_query(sql), nullptr turns it off.
+     */
+    void set_profiler(query_profiler *profiler);
+    query_profiler *profiler() const;
+
+    /*
+     * Registers a C++ callable as an SQL function. Its parameters and result
+     * are converted at compile time: integers, floating point, std::string,
+     * string_view, span<const std::byte>, optional of those for NULL, or a raw
+     * sqlite3_value *. An exception becomes the SQL error.
+     *
+     *   db.create_function("clamp", [](double x, double lo, double hi) { return std::clamp(x, lo, hi); });
+     */
+    template <typename F>
+    void create_function(const char *name, F function, int flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC);
+
+    /*
+     * Registers an aggregate from step(State &, args...) and final(State &).
+     * State is default-constructed in place in sqlite3_aggregate_context and
+     * destroyed after final, so a group costs no allocation of its own.
+     *
+     *   struct mean { double sum = 0; long n = 0; };
+     *   db.create_aggregate("mean", [](mean &m, double x) { m.sum += x; ++m.n; },
+     *                       [](mean &m) { return m.n ? std::optional(m.sum / m.n) : std::nullopt; });
+     */
+    template <typename Step_T, typename Final_T>
+    void create_aggregate(const char *name, Step_T step, Final_T final, int flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC);
+
     bool is_open() const;
     explicit operator sqlite3 *();
     operator bool();
 };
 
+template <typename F>
+void connection::create_function(const char *name, F function, int flags)
+{
+    using arguments = typename detail::callable_traits<F>::arguments;
+
+    auto *data = new F(std::move(function));
+    // SQLite calls the destroy callback itself if registering fails
+    int rc = sqlite3_create_function_v2(m_db, name, static_cast<int>(std::tuple_size<arguments>::value), flags, data,
+                                        &detail::scalar_function<F>, nullptr, nullptr, &detail::destroy_user_data<F>);
+    if (database_exception::is_error_code(rc))
+    {
+        throw database_exception(sqlite3_errmsg(m_db));
+    }
+}
+
+template <typename Step_T, typename Final_T>
+void connection::create_aggregate(const char *name, Step_T step, Final_T final, int flags)
+{
+    using arguments = typename detail::callable_traits<Step_T>::arguments;
+    using state = std::tuple_element_t<0, arguments>;
+    using functions = detail::aggregate_functions<Step_T, Final_T>;
+    static_assert(std::is_default_constructible<state>::value, "aggregate state must be default constructible");
+    // sqlite3_aggregate_context memory is only 8-byte aligned
+    static_assert(alignof(detail::aggregate_slot<state>) <= 8, "aggregate state is over-aligned");
+
+    auto *data = new functions{std::move(step), std::move(final)};
+    int rc = sqlite3_create_function_v2(m_db, name, static_cast<int>(std::tuple_size<arguments>::value - 1), flags, data,
+                                        nullptr, &detail::aggregate_step<state, Step_T, Final_T>,
+                                        &detail::aggregate_final<state, Step_T, Final_T>, &detail::destroy_user_data<functions>);
+    if (database_exception::is_error_code(rc))
+    {
+        throw database_exception(sqlite3_errmsg(m_db));
+    }
+}
+
 }; // namespace sqlite_connect
@@ -0,0 +1,241 @@
+
+#include "connection_options.hpp"
+#include "database_exception.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+using namespace sqlite_connect;
+
+namespace
+{
+
+const char *to_string(connection_options::journal mode)
+{
+    switch (mode)
+    {
+    case connection_options::journal::DELETE: return "DELETE";
+    case connection_options::journal::TRUNCATE: return "TRUNCATE";
+    case connection_options::journal::PERSIST: return "PERSIST";
+    case connection_options::journal::MEMORY: return "MEMORY";
+    case connection_options::journal::WAL: return "WAL";
+    case connection_options::journal::OFF: return "OFF";
+    }
+    return "DELETE";
+}
+
+const char *to_string(connection_options::sync mode)
+{
+    switch (mode)
+    {
+    case connection_options::sync::OFF: return "OFF";
+    case connection_options::sync::NORMAL: return "NORMAL";
+    case connection_options::sync::FULL: return "FULL";
+    case connection_options::sync::EXTRA: return "EXTRA";
+    }
+    return "FULL";
+}
+
+const char *to_string(connection_options::temp mode)
+{
+    switch (mode)
+    {
+    case connection_options::temp::DEFAULT: return "DEFAULT";
+    case connection_options::temp::FILE: return "FILE";
+    case connection_options::temp::MEMORY: return "MEMORY";
+    }
+    return "DEFAULT";
+}
+
+// Runs pragma and returns the first column of its first row, if it has one
+std::string run_pragma(sqlite3 *db, std::string const &pragma)
+{
+    std::string result;
+    auto first_value = [](void *out, int columns, char **values, char **) {
+        auto *text = static_cast<std::string *>(out);
+        if (text->empty() && columns > 0 && values[0] != nullptr)
+        {
+            *text = values[0];
+        }
+        return 0;
+    };
+
+    char *err = nullptr;
+    int rc = sqlite3_exec(db, pragma.c_str(), first_value, &result, &err);
+    if (database_exception::is_error_code(rc))
+    {
+        std::string message = pragma + ": " + (err != nullptr ? err : sqlite3_errmsg(db));
+        sqlite3_free(err);
+        throw database_exception(message);
+    }
+    return result;
+}
+
+bool same_mode(std::string const &reported, const char *wanted)
+{
+    return std::equal(reported.begin(), reported.end(), wanted, wanted + std::strlen(wanted),
+                      [](char a, char b) { return std::toupper(static_cast<unsigned char>(a)) == b; });
+}
+
+} // namespace
+
+connection_options &connection_options::flags(int flags)
+{
+    m_flags = flags;
+    return *this;
+}
+
+connection_options &connection_options::mmap_size(long long bytes)
+{
+    m_mmap_size = bytes;
+    return *this;
+}
+
+connection_options &connection_options::cache_size(int size)
+{
+    m_cache_size = size;
+    return *this;
+}
+
+connection_options &connection_options::page_size(int bytes)
+{
+    m_page_size = bytes;
+    return *this;
+}
+
+connection_options &connection_options::journal_mode(journal mode)
+{
+    m_journal_mode = mode;
+    return *this;
+}
+
+connection_options &connection_options::synchronous(sync mode)
+{
+    m_synchronous = mode;
+    return *this;
+}
+
+connection_options &connection_options::temp_store(temp mode)
+{
+    m_temp_store = mode;
+    return *this;
+}
+
+connection_options &connection_options::busy_timeout(std::chrono::milliseconds timeout)
+{
+    m_busy_timeout = timeout;
+    return *this;
+}
+
+int connection_options::open_flags() const
+{
+    return m_flags;
+}
+
+std::string connection_options::describe() const
+{
+    std::string text;
+    auto add = [&text](std::string const &setting) {
+        text += text.empty() ? "" : " ";
+        text += setting;
+    };
+
+    if (m_page_size)
+    {
+        add("page_size=" + std::to_string(*m_page_size));
+    }
+    if (m_journal_mode)
+    {
+        add(std::string("journal_mode=") + to_string(*m_journal_mode));
+    }
+    if (m_synchronous)
+    {
+        add(std::string("synchronous=") + to_string(*m_synchronous));
+    }
+    if (m_cache_size)
+    {
+        add("cache_size=" + std::to_string(*m_cache_size));
+    }
+    if (m_mmap_size)
+    {
+        add("mmap_size=" + std::to_string(*m_mmap_size));
+    }
+    if (m_temp_store)
+    {
+        add(std::string("temp_store=") + to_string(*m_temp_store));
+    }
+    if (m_busy_timeout)
+    {
+        add("busy_timeout=" + std::to_string(m_busy_timeout->count()));
+    }
+    return text.empty() ? "defaults" : text;
+}
+
+void connection_options::apply(sqlite3 *db) const
+{
+    // First, so the PRAGMAs that lock the file wait for other connections too
+    if (m_busy_timeout)
+    {
+        database_exception::throw_on_error(sqlite3_busy_timeout(db, static_cast<int>(m_busy_timeout->count())));
+    }
+    if (m_page_size)
+    {
+        run_pragma(db, "PRAGMA page_size=" + std::to_string(*m_page_size));
+    }
+    if (m_journal_mode)
+    {
+        // SQLite answers with the mode it ended up in instead of failing
+        std::string pragma = std::string("PRAGMA journal_mode=") + to_string(*m_journal_mode);
+        std::string mode = run_pragma(db, pragma);
+        if (!same_mode(mode, to_string(*m_journal_mode)))
+        {
+            throw database_exception(pragma + ": the database stayed in journal_mode " + mode);
+        }
+    }
+    if (m_synchronous)
+    {
+        run_pragma(db, std::string("PRAGMA synchronous=") + to_string(*m_synchronous));
+    }
+    if (m_cache_size)
+    {
+        run_pragma(db, "PRAGMA cache_size=" + std::to_string(*m_cache_size));
+    }
+    if (m_mmap_size)
+    {
+        run_pragma(db, "PRAGMA mmap_size=" + std::to_string(*m_mmap_size));
+    }
+    if (m_temp_store)
+    {
+        run_pragma(db, std::string("PRAGMA temp_store=") + to_string(*m_temp_store));
+    }
+}
+
+connection_options connection_options::read_heavy()
+{
+    return connection_options()
+        .journal_mode(journal::WAL)
+        .synchronous(sync::NORMAL)
+        .cache_size(-131072)
+        .mmap_size(1LL << 30)
+        .temp_store(temp::MEMORY)
+        .busy_timeout(std::chrono::milliseconds(5000));
+}
+
+connection_options connection_options::write_heavy()
+{
+    return connection_options()
+        .journal_mode(journal::WAL)
+        .synchronous(sync::NORMAL)
+        .cache_size(-65536)
+        .temp_store(temp::MEMORY)
+        .busy_timeout(std::chrono::milliseconds(5000));
+}
+
+connection_options connection_options::ephemeral()
+{
+    return connection_options()
+        .journal_mode(journal::OFF)
+        .synchronous(sync::OFF)
+        .cache_size(-65536)
+        .temp_store(temp::MEMORY);
+}
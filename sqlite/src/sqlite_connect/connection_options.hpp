@@ -0,0 +1,92 @@
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include "sqlite3.h"
+
+namespace sqlite_connect
+{
+
+/*
+ * How to open and tune a connection. Settings left unset keep SQLite's
+ * defaults. The setters chain:
+ *
+ *   connection db("app.db", connection_options::read_heavy().cache_size(-16384));
+ *
+ * page_size only takes effect on a new database (or after VACUUM), and is
+ * applied before journal_mode because WAL fixes it.
+ */
+class connection_options
+{
+public:
+    enum class journal
+    {
+        DELETE,
+        TRUNCATE,
+        PERSIST,
+        MEMORY,
+        WAL,
+        OFF
+    };
+
+    enum class sync
+    {
+        OFF,
+        NORMAL,
+        FULL,
+        EXTRA
+    };
+
+    enum class temp
+    {
+        DEFAULT,
+        FILE,
+        MEMORY
+    };
+
+private:
+    int m_flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    std::optional<long long> m_mmap_size;
+    std::optional<int> m_cache_size;
+    std::optional<int> m_page_size;
+    std::optional<journal> m_journal_mode;
+    std::optional<sync> m_synchronous;
+    std::optional<temp> m_temp_store;
+    std::optional<std::chrono::milliseconds> m_busy_timeout;
+
+public:
+    // SQLITE_OPEN_* flags for sqlite3_open_v2
+    connection_options &flags(int flags);
+    // Bytes of the file to memory-map, 0 turns it off
+    connection_options &mmap_size(long long bytes);
+    // Pages when positive, KiB when negative, as PRAGMA cache_size
+    connection_options &cache_size(int size);
+    connection_options &page_size(int bytes);
+    connection_options &journal_mode(journal mode);
+    connection_options &synchronous(sync mode);
+    connection_options &temp_store(temp mode);
+    connection_options &busy_timeout(std::chrono::milliseconds timeout);
+
+    int open_flags() const;
+
+    /*
+     * Sets the busy timeout, then runs the PRAGMAs on an open database.
+     * Throws database_exception if one fails or if the database keeps
+     * another journal mode, e.g. WAL asked of a :memory: database.
+     */
+    void apply(sqlite3 *db) const;
+
+    // The settings as PRAGMA text, for logs and benchmark output
+    std::string describe() const;
+
+    // WAL, a 128MB cache and 1GB of mmap for mostly-read databases
+    static connection_options read_heavy();
+    // WAL with synchronous=NORMAL, which only syncs at checkpoints, and a 64MB cache
+    static connection_options write_heavy();
+    // No journal and no syncs, for scratch data that can be rebuilt after a crash
+    static connection_options ephemeral();
+};
+
+}; // namespace sqlite_connect
@@ -0,0 +1,199 @@
+
+#include "connection_pool.hpp"
+#include "prepared_statement.hpp"
+#include <functional>
+
+using namespace sqlite_connect;
+
+namespace
+{
+
+std::shared_ptr<connection> open_pooled(std::string const &name, int flags, std::chrono::milliseconds busy_timeout)
+{
+    auto conn = std::make_shared<connection>(name, flags | SQLITE_OPEN_NOMUTEX);
+    if (!conn->is_open())
+    {
+        throw database_exception("Could not open " + name);
+    }
+    database_exception::throw_on_error(
+        sqlite3_busy_timeout(static_cast<sqlite3 *>(*conn), static_cast<int>(busy_timeout.count())));
+    return conn;
+}
+
+} // namespace
+
+connection_lease::connection_lease(connection_pool *pool, std::shared_ptr<connection> conn, size_t index, bool writer)
+    : m_pool(pool), m_connection(std::move(conn)), m_index(index), m_writer(writer)
+{
+}
+
+connection_lease::~connection_lease()
+{
+    release();
+}
+
+connection_lease::connection_lease(connection_lease &&other) noexcept
+    : m_pool(other.m_pool), m_connection(std::move(other.m_connection)), m_index(other.m_index), m_writer(other.m_writer)
+{
+    other.m_pool = nullptr;
+}
+
+connection_lease &connection_lease::operator=(connection_lease &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_pool = other.m_pool;
+        m_connection = std::move(other.m_connection);
+        m_index = other.m_index;
+        m_writer = other.m_writer;
+        other.m_pool = nullptr;
+    }
+    return *this;
+}
+
+connection &connection_lease::operator*()
+{
+    return *m_connection;
+}
+
+connection *connection_lease::operator->()
+{
+    return m_connection.get();
+}
+
+std::shared_ptr<connection> connection_lease::shared() const
+{
+    return m_connection;
+}
+
+size_t connection_lease::index() const
+{
+    return m_index;
+}
+
+bool connection_lease::is_writer() const
+{
+    return m_writer;
+}
+
+void connection_lease::release()
+{
+    if (m_pool != nullptr)
+    {
+        m_connection.reset();
+        m_pool->give_back(m_index, m_writer);
+        m_pool = nullptr;
+    }
+}
+
+connection_lease::operator bool() const
+{
+    return m_pool != nullptr;
+}
+
+connection_pool::connection_pool(std::string name, size_t readers, std::chrono::milliseconds busy_timeout)
+    : m_name(name)
+{
+    if (readers == 0)
+    {
+        throw database_exception("A connection pool needs at least one reader");
+    }
+
+    // The writer creates the file and switches it to WAL, which is persistent
+    m_writer = open_pooled(m_name, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, busy_timeout);
+
+    prepared_statement journal_mode;
+    journal_mode.prepare(static_cast<sqlite3 *>(*m_writer), "PRAGMA journal_mode=WAL");
+    std::string mode;
+    if (journal_mode.step())
+    {
+        journal_mode.extract_column(0, mode);
+    }
+    if (mode != "wal")
+    {
+        throw database_exception("Could not switch " + m_name + " to WAL, journal mode is " + mode);
+    }
+    m_writer->execute_query("PRAGMA synchronous=NORMAL");
+
+    for (size_t i = 0; i < readers; ++i)
+    {
+        m_readers.push_back(open_pooled(m_name, SQLITE_OPEN_READONLY, busy_timeout));
+    }
+    m_reader_busy.assign(readers, false);
+    m_last_thread.assign(readers, std::thread::id());
+}
+
+bool connection_pool::find_free_reader(std::thread::id thread, size_t &index) const
+{
+    // Start looking at a per-thread offset so new threads spread out
+    size_t start = std::hash<std::thread::id>{}(thread) % m_readers.size();
+    bool found = false;
+    for (size_t i = 0; i < m_readers.size(); ++i)
+    {
+        size_t candidate = (start + i) % m_readers.size();
+        if (m_reader_busy[candidate])
+        {
+            continue;
+        }
+        if (m_last_thread[candidate] == thread)
+        {
+            index = candidate;
+            return true;
+        }
+        if (!found)
+        {
+            index = candidate;
+            found = true;
+        }
+    }
+    return found;
+}
+
+connection_lease connection_pool::reader()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto thread = std::this_thread::get_id();
+    size_t index = 0;
+
+    m_released.wait(lock, [&]() { return find_free_reader(thread, index); });
+
+    m_reader_busy[index] = true;
+    m_last_thread[index] = thread;
+    return connection_lease(this, m_readers[index], index, false);
+}
+
+connection_lease connection_pool::writer()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_released.wait(lock, [this]() { return !m_writer_busy; });
+
+    m_writer_busy = true;
+    return connection_lease(this, m_writer, 0, true);
+}
+
+void connection_pool::give_back(size_t index, bool writer)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (writer)
+        {
+            m_writer_busy = false;
+        }
+        else
+        {
+            m_reader_busy[index] = false;
+        }
+    }
+    m_released.notify_all();
+}
+
+size_t connection_pool::readers() const
+{
+    return m_readers.size();
+}
+
+std::string const &connection_pool::name() const
+{
+    return m_name;
+}
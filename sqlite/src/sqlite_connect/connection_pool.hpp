@@ -0,0 +1,98 @@
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "connection.hpp"
+
+namespace sqlite_connect
+{
+
+class connection_pool;
+
+/*
+ * A connection borrowed from a connection_pool. It is handed back when the
+ * lease is destroyed or released, so nothing prepared on it may outlive the
+ * lease.
+ */
+class connection_lease
+{
+private:
+    connection_pool *m_pool = nullptr;
+    std::shared_ptr<connection> m_connection;
+    size_t m_index = 0;
+    bool m_writer = false;
+
+public:
+    connection_lease() = default;
+    connection_lease(connection_pool *pool, std::shared_ptr<connection> conn, size_t index, bool writer);
+    virtual ~connection_lease();
+
+    connection_lease(connection_lease &) = delete;
+    connection_lease &operator=(connection_lease &) = delete;
+
+    connection_lease(connection_lease &&other) noexcept;
+    connection_lease &operator=(connection_lease &&other) noexcept;
+
+    connection &operator*();
+    connection *operator->();
+
+    // For APIs that take a shared connection, such as transaction
+    std::shared_ptr<connection> shared() const;
+
+    size_t index() const;
+    bool is_writer() const;
+    void release();
+    explicit operator bool() const;
+};
+
+/*
+ * N read-only connections and one writer connection to a database file in
+ * WAL mode, so readers run in parallel with each other and with the writer.
+ *
+ * Connections are opened without SQLite's own mutex since a lease gives one
+ * thread sole use of a connection. A thread gets the reader it used last if
+ * that one is free and no other thread used it since, which keeps the
+ * statements prepared on it warm.
+ */
+class connection_pool
+{
+private:
+    friend class connection_lease;
+
+    std::string m_name;
+    std::vector<std::shared_ptr<connection>> m_readers;
+    std::vector<bool> m_reader_busy;
+    // The thread that last leased each reader, so the memory stays bounded however many threads come and go
+    std::vector<std::thread::id> m_last_thread;
+    std::shared_ptr<connection> m_writer;
+    bool m_writer_busy = false;
+
+    std::mutex m_mutex;
+    std::condition_variable m_released;
+
+    bool find_free_reader(std::thread::id thread, size_t &index) const;
+    void give_back(size_t index, bool writer);
+
+public:
+    connection_pool(std::string name, size_t readers = 4,
+                    std::chrono::milliseconds busy_timeout = std::chrono::milliseconds(5000));
+    virtual ~connection_pool() = default;
+
+    connection_pool(connection_pool &) = delete;
+    connection_pool &operator=(connection_pool &) = delete;
+
+    // Block until a connection is free
+    connection_lease reader();
+    connection_lease writer();
+
+    size_t readers() const;
+    std::string const &name() const;
+};
+
+}; // namespace sqlite_connect
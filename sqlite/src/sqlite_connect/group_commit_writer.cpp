@@ -0,0 +1,194 @@
+
+#include "group_commit_writer.hpp"
+
+using namespace sqlite_connect;
+
+group_commit_writer::group_commit_writer(std::shared_ptr<connection> db, size_t max_batch, std::chrono::microseconds window)
+    : m_db(std::move(db)), m_max_batch(max_batch == 0 ? 1 : max_batch), m_window(window)
+{
+    if (!m_db || !m_db->is_open())
+    {
+        throw database_exception("Database is not open");
+    }
+    m_thread = std::thread([this]() { run(); });
+}
+
+group_commit_writer::group_commit_writer(std::string name, size_t max_batch, std::chrono::microseconds window)
+    : group_commit_writer(std::make_shared<connection>(name), max_batch, window)
+{
+}
+
+group_commit_writer::~group_commit_writer()
+{
+    stop();
+}
+
+std::future<void> group_commit_writer::enqueue(std::shared_ptr<iquery> query)
+{
+    item write{std::move(query), std::promise<void>()};
+    std::future<void> result = write.done.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping)
+        {
+            throw database_exception("The writer is stopped");
+        }
+        m_queue.push_back(std::move(write));
+    }
+    m_arrived.notify_one();
+    return result;
+}
+
+void group_commit_writer::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_arrived.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void group_commit_writer::run()
+{
+    std::vector<item> batch;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_arrived.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty())
+            {
+                return;
+            }
+
+            // Keep collecting until the batch is full or the window after its first write has passed
+            auto deadline = std::chrono::steady_clock::now() + m_window;
+            m_arrived.wait_until(lock, deadline, [this]() { return m_stopping || m_queue.size() >= m_max_batch; });
+
+            while (!m_queue.empty() && batch.size() < m_max_batch)
+            {
+                batch.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+        }
+
+        commit_batch(batch);
+        batch.clear();
+    }
+}
+
+void group_commit_writer::commit_batch(std::vector<item> &batch)
+{
+    std::vector<std::exception_ptr> errors(batch.size());
+    sqlite3 *db = static_cast<sqlite3 *>(*m_db);
+
+    // Items from first on run in the current transaction
+    size_t first = 0;
+    auto begin = [&]() {
+        try
+        {
+            m_db->execute_query("BEGIN IMMEDIATE TRANSACTION");
+            return true;
+        }
+        catch (...)
+        {
+            for (size_t i = first; i < batch.size(); ++i)
+            {
+                errors[i] = std::current_exception();
+            }
+            return false;
+        }
+    };
+
+    if (!begin())
+    {
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            batch[i].done.set_exception(errors[i]);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        try
+        {
+            m_db->execute_query("SAVEPOINT group_commit_item");
+            m_db->execute_query(*batch[i].query);
+            m_db->execute_query("RELEASE group_commit_item");
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+            if (!sqlite3_get_autocommit(db))
+            {
+                sqlite3_exec(db, "ROLLBACK TO group_commit_item", nullptr, nullptr, nullptr);
+                sqlite3_exec(db, "RELEASE group_commit_item", nullptr, nullptr, nullptr);
+                continue;
+            }
+
+            // Errors such as INSERT OR ROLLBACK, SQLITE_FULL or SQLITE_IOERR roll back the whole
+            // transaction, taking the earlier items with it, and the rest must not run in autocommit
+            for (size_t j = first; j < i; ++j)
+            {
+                if (!errors[j])
+                {
+                    errors[j] = errors[i];
+                }
+            }
+            first = i + 1;
+            if (first < batch.size() && !begin())
+            {
+                break;
+            }
+        }
+    }
+
+    // Without an open transaction every remaining item already has its error
+    std::exception_ptr commit_error;
+    try
+    {
+        if (!sqlite3_get_autocommit(db))
+        {
+            m_db->execute_query("COMMIT TRANSACTION");
+        }
+    }
+    catch (...)
+    {
+        commit_error = std::current_exception();
+        if (!sqlite3_get_autocommit(db))
+        {
+            sqlite3_exec(db, "ROLLBACK TRANSACTION", nullptr, nullptr, nullptr);
+        }
+    }
+
+    ++m_batches;
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        std::exception_ptr error = errors[i] ? errors[i] : commit_error;
+        if (error)
+        {
+            batch[i].done.set_exception(error);
+        }
+        else
+        {
+            ++m_writes;
+            batch[i].done.set_value();
+        }
+    }
+}
+
+size_t group_commit_writer::batches() const
+{
+    return m_batches;
+}
+
+size_t group_commit_writer::writes() const
+{
+    return m_writes;
+}
@@ -0,0 +1,78 @@
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "connection.hpp"
+#include "iquery.hpp"
+
+namespace sqlite_connect
+{
+
+/*
+ * A single writer thread that commits many small writes together. Writes
+ * that arrive within the window after the first one of a batch, up to
+ * max_batch of them, run in one transaction and pay for one commit. With
+ * the default window of zero, a batch is whatever queued up while the
+ * previous one was committing, which needs no tuning. Every write runs
+ * inside its own savepoint, so a failing write is rolled back alone and only
+ * its future gets the error; the futures of the others are completed after
+ * the commit. A write whose error rolls back the whole transaction, such as
+ * INSERT OR ROLLBACK or a full disk, fails the earlier writes of the batch
+ * with its error, and the writes after it run in a new transaction.
+ *
+ * The writer uses its connection exclusively while it runs.
+ */
+class group_commit_writer
+{
+private:
+    struct item
+    {
+        std::shared_ptr<iquery> query;
+        std::promise<void> done;
+    };
+
+    std::shared_ptr<connection> m_db;
+    size_t m_max_batch;
+    std::chrono::microseconds m_window;
+
+    std::deque<item> m_queue;
+    bool m_stopping = false;
+    std::mutex m_mutex;
+    std::condition_variable m_arrived;
+
+    std::atomic<size_t> m_batches{0};
+    std::atomic<size_t> m_writes{0};
+    std::thread m_thread;
+
+    void run();
+    void commit_batch(std::vector<item> &batch);
+
+public:
+    group_commit_writer(std::shared_ptr<connection> db, size_t max_batch = 256,
+                        std::chrono::microseconds window = std::chrono::microseconds(0));
+    group_commit_writer(std::string name, size_t max_batch = 256,
+                        std::chrono::microseconds window = std::chrono::microseconds(0));
+    virtual ~group_commit_writer();
+
+    group_commit_writer(group_commit_writer &) = delete;
+    group_commit_writer &operator=(group_commit_writer &) = delete;
+
+    std::future<void> enqueue(std::shared_ptr<iquery> query);
+
+    // Commits what is queued and stops the writer thread
+    void stop();
+
+    size_t batches() const;
+    size_t writes() const;
+};
+
+}; // namespace sqlite_connect
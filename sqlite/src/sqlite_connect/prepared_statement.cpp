@@ -1,5 +1,6 @@
 
 #include "prepared_statement.hpp"
+#include "query_profiler.hpp"
 
 using namespace sqlite_connect;
 
@@ -16,11 +17,37 @@ prepared_statement::~prepared_statement()
     sqlite3_finalize(m_stmt);
 }
 
+void prepared_statement::record_execution()
+{
+    if (m_unrecorded && m_profiler != nullptr)
+    {
+        m_profiler->record(sqlite3_sql(m_stmt), m_elapsed, m_rows, m_stmt);
+    }
+    m_unrecorded = false;
+    m_elapsed = std::chrono::nanoseconds(0);
+}
+
+void prepared_statement::set_profiler(query_profiler *profiler)
+{
+    // The old profiler may be gone, so an unfinished execution is dropped
+    if (profiler != m_profiler)
+    {
+        m_unrecorded = false;
+        m_elapsed = std::chrono::nanoseconds(0);
+        m_profiler = profiler;
+    }
+}
+
 void prepared_statement::bind(size_t i, int value)
 {
     database_exception::throw_on_error(sqlite3_bind_int(m_stmt, i, value));
 }
 
+void prepared_statement::bind(size_t i, long value)
+{
+    database_exception::throw_on_error(sqlite3_bind_int64(m_stmt, i, value));
+}
+
 void prepared_statement::bind(size_t i, long long value)
 {
     database_exception::throw_on_error(sqlite3_bind_int64(m_stmt, i, value));
@@ -38,12 +65,45 @@ void prepared_statement::bind(size_t i, float value)
 
 void prepared_statement::bind(size_t i, std::string const &value)
 {
-    database_exception::throw_on_error(sqlite3_bind_text(m_stmt, i, value.c_str(), -1, nullptr));
+    bind(i, std::string_view(value), lifetime::TRANSIENT);
+}
+
+namespace
+{
+
+sqlite3_destructor_type destructor_for(lifetime life)
+{
+    return life == lifetime::STATIC ? SQLITE_STATIC : SQLITE_TRANSIENT;
+}
+
+} // namespace
+
+void prepared_statement::bind(size_t i, std::string_view value, lifetime life)
+{
+    database_exception::throw_on_error(
+        sqlite3_bind_text64(m_stmt, i, value.data(), value.size(), destructor_for(life), SQLITE_UTF8));
+}
+
+void prepared_statement::bind(size_t i, std::span<const std::byte> value, lifetime life)
+{
+    // A null pointer would bind NULL instead of an empty blob
+    static const std::byte empty{};
+    const void *data = value.empty() ? &empty : value.data();
+    database_exception::throw_on_error(sqlite3_bind_blob64(m_stmt, i, data, value.size(), destructor_for(life)));
+}
+
+void prepared_statement::bind_null(size_t i)
+{
+    database_exception::throw_on_error(sqlite3_bind_null(m_stmt, i));
 }
 
 void prepared_statement::prepare(sqlite3 *db, const char *sql, const char **more)
 {
-    database_exception::throw_on_error(sqlite3_prepare_v2(db, sql, -1, &m_stmt, more));
+    int rc = sqlite3_prepare_v2(db, sql, -1, &m_stmt, more);
+    if (database_exception::is_error_code(rc))
+    {
+        throw database_exception(sqlite3_errmsg(db));
+    }
 }
 
 void prepared_statement::extract_column(size_t i, int &output)
@@ -52,6 +112,12 @@ void prepared_statement::extract_column(size_t i, int &output)
     output = sqlite3_column_int(m_stmt, i);
 }
 
+void prepared_statement::extract_column(size_t i, long &output)
+{
+    throw_on_no_row();
+    output = sqlite3_column_int64(m_stmt, i);
+}
+
 void prepared_statement::extract_column(size_t i, long long &output)
 {
     throw_on_no_row();
@@ -71,45 +137,86 @@ void prepared_statement::extract_column(size_t i, double &output)
 }
 
 void prepared_statement::extract_column(size_t i, std::string &output)
+{
+    std::string_view text;
+    extract_column(i, text);
+    output.assign(text.data(), text.size());
+}
+
+void prepared_statement::extract_column(size_t i, std::string_view &output)
 {
     throw_on_no_row();
-    output = reinterpret_cast<const char *>(sqlite3_column_text(m_stmt, i));
+    // sqlite3_column_bytes after sqlite3_column_text gives the length of the converted text
+    const char *text = reinterpret_cast<const char *>(sqlite3_column_text(m_stmt, i));
+    output = text == nullptr ? std::string_view() : std::string_view(text, sqlite3_column_bytes(m_stmt, i));
+}
+
+void prepared_statement::extract_column(size_t i, std::span<const std::byte> &output)
+{
+    throw_on_no_row();
+    const std::byte *blob = static_cast<const std::byte *>(sqlite3_column_blob(m_stmt, i));
+    output = blob == nullptr ? std::span<const std::byte>() : std::span<const std::byte>(blob, sqlite3_column_bytes(m_stmt, i));
 }
 
 bool prepared_statement::step()
 {
     m_has_row = false;
-    int rc = sqlite3_step(m_stmt);
+    int rc;
+    if (m_profiler == nullptr)
+    {
+        rc = sqlite3_step(m_stmt);
+    }
+    else
+    {
+        auto start = std::chrono::steady_clock::now();
+        rc = sqlite3_step(m_stmt);
+        m_elapsed += std::chrono::steady_clock::now() - start;
+        m_unrecorded = true;
+    }
 
     if (rc == SQLITE_ROW)
     {
         m_has_row = true;
+        ++m_rows;
         return true;
     }
-    else if (rc == SQLITE_DONE)
+
+    record_execution();
+    if (rc == SQLITE_DONE)
     {
         return false;
     }
-    else
-    {
-        throw database_exception(sqlite3_errstr(rc));
-    }
+    throw database_exception(sqlite3_errmsg(sqlite3_db_handle(m_stmt)));
 }
 
 void prepared_statement::reset()
 {
+    // A read that stopped before SQLITE_DONE ends here
+    record_execution();
+    m_has_row = false;
+    m_rows = 0;
     int rc = sqlite3_reset(m_stmt);
     if (database_exception::is_error_code(rc))
     {
-        throw database_exception(sqlite3_errstr(rc));
+        throw database_exception(sqlite3_errmsg(sqlite3_db_handle(m_stmt)));
     }
 }
 
+void prepared_statement::clear_bindings()
+{
+    database_exception::throw_on_error(sqlite3_clear_bindings(m_stmt));
+}
+
 bool prepared_statement::has_row() const
 {
     return m_has_row;
 }
 
+size_t prepared_statement::rows() const
+{
+    return m_rows;
+}
+
 prepared_statement::operator sqlite3_stmt *()
 {
     return m_stmt;
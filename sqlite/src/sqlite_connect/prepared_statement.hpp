@@ -3,18 +3,43 @@
 
 #include "sqlite3.h"
 #include "database_exception.hpp"
+#include <chrono>
+#include <cstddef>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace sqlite_connect {
 
+    class query_profiler;
+
+    /*
+     * Who keeps bound text and blobs alive: STATIC means the caller does,
+     * until the statement is stepped and reset or rebound, TRANSIENT means
+     * SQLite takes a copy.
+     */
+    enum class lifetime
+    {
+        STATIC,
+        TRANSIENT
+    };
+
     class prepared_statement
     {
     private:
         sqlite3_stmt *m_stmt = nullptr;
         bool m_has_row = false;
+        size_t m_rows = 0;
+
+        // Time spent in sqlite3_step since the last recorded execution
+        query_profiler *m_profiler = nullptr;
+        std::chrono::nanoseconds m_elapsed{0};
+        bool m_unrecorded = false;
 
         void throw_on_no_row(void);
+        void record_execution();
 
     public:
         prepared_statement() = default;
@@ -29,25 +54,71 @@ namespace sqlite_connect {
         void prepare(sqlite3 *db, const char *sql, const char **more = nullptr);
 
         void bind(size_t i, int value);
+        void bind(size_t i, long value);
         void bind(size_t i, long long value);
         void bind(size_t i, double value);
         void bind(size_t i, float value);
         void bind(size_t i, std::string const &value);
+        void bind(size_t i, std::string_view value, lifetime life);
+        void bind(size_t i, std::span<const std::byte> value, lifetime life);
+        void bind_null(size_t i);
+
+        // Binds any integer, floating point or string-like value
+        template <typename Value_T>
+        void bind_value(size_t i, Value_T const &value, lifetime life = lifetime::TRANSIENT)
+        {
+            if constexpr (std::is_same<Value_T, std::nullptr_t>::value)
+            {
+                bind_null(i);
+            }
+            else if constexpr (std::is_integral<Value_T>::value)
+            {
+                bind(i, static_cast<long long>(value));
+            }
+            else if constexpr (std::is_floating_point<Value_T>::value)
+            {
+                bind(i, static_cast<double>(value));
+            }
+            else if constexpr (std::is_convertible<Value_T const &, std::span<const std::byte>>::value)
+            {
+                bind(i, std::span<const std::byte>(value), life);
+            }
+            else
+            {
+                bind(i, std::string_view(value), life);
+            }
+        }
 
         void extract_column(size_t i, int &output);
 
+        void extract_column(size_t i, long &output);
         void extract_column(size_t i, long long &output);
 
         void extract_column(size_t i, float &output);
         void extract_column(size_t i, double &output);
         void extract_column(size_t i, std::string &output);
 
+        // Views into the current row, valid until the next step or reset
+        void extract_column(size_t i, std::string_view &output);
+        void extract_column(size_t i, std::span<const std::byte> &output);
+
         bool step();
 
         void reset();
+        void clear_bindings();
 
         bool has_row() const;
 
+        // Rows stepped over since the last reset
+        size_t rows() const;
+
+        /*
+         * Times every sqlite3_step and records one execution into profiler
+         * when it finishes, fails or is reset, nullptr turns it off. The
+         * profiler must outlive the statement's use.
+         */
+        void set_profiler(query_profiler *profiler);
+
         operator sqlite3_stmt *();
 
     };
@@ -0,0 +1,174 @@
+
+#include "query_profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+
+using namespace sqlite_connect;
+
+namespace
+{
+
+size_t bucket_for(std::chrono::nanoseconds elapsed)
+{
+    uint64_t us = static_cast<uint64_t>(elapsed.count()) / 1000;
+    size_t bucket = 0;
+    while (us > 0 && bucket + 1 < query_stats::buckets)
+    {
+        us >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+std::string csv_quoted(std::string const &text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        quoted += c;
+        if (c == '"')
+        {
+            quoted += '"';
+        }
+    }
+    quoted += '"';
+    return quoted;
+}
+
+std::string json_quoted(std::string const &text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"': quoted += "\\\""; break;
+        case '\\': quoted += "\\\\"; break;
+        case '\n': quoted += "\\n"; break;
+        case '\r': quoted += "\\r"; break;
+        case '\t': quoted += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escape[8];
+                std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                quoted += escape;
+            }
+            else
+            {
+                quoted += c;
+            }
+        }
+    }
+    quoted += '"';
+    return quoted;
+}
+
+double to_us(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+} // namespace
+
+double query_stats::percentile_us(double fraction) const
+{
+    uint64_t wanted = static_cast<uint64_t>(fraction * calls);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets; ++i)
+    {
+        seen += histogram[i];
+        if (seen > wanted || seen == calls)
+        {
+            return static_cast<double>(uint64_t(1) << i);
+        }
+    }
+    return static_cast<double>(uint64_t(1) << (buckets - 1));
+}
+
+void query_profiler::record(const char *sql, std::chrono::nanoseconds elapsed, uint64_t rows, sqlite3_stmt *stmt)
+{
+    uint64_t vm_steps = 0, fullscan_steps = 0, sorts = 0, autoindexes = 0;
+    if (stmt != nullptr)
+    {
+        vm_steps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+        fullscan_steps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+        sorts = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1);
+        autoindexes = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_stats.find(sql);
+    if (found == m_stats.end())
+    {
+        found = m_stats.emplace(sql, query_stats()).first;
+        found->second.sql = sql;
+    }
+
+    query_stats &stats = found->second;
+    ++stats.calls;
+    stats.rows += rows;
+    stats.total += elapsed;
+    stats.max = std::max(stats.max, elapsed);
+    ++stats.histogram[bucket_for(elapsed)];
+    stats.vm_steps += vm_steps;
+    stats.fullscan_steps += fullscan_steps;
+    stats.sorts += sorts;
+    stats.autoindexes += autoindexes;
+}
+
+std::vector<query_stats> query_profiler::report() const
+{
+    std::vector<query_stats> all;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto const &entry : m_stats)
+        {
+            all.push_back(entry.second);
+        }
+    }
+    std::sort(all.begin(), all.end(), [](query_stats const &a, query_stats const &b) { return a.total > b.total; });
+    return all;
+}
+
+void query_profiler::write_csv(std::ostream &out) const
+{
+    out << "sql,calls,rows,total_us,mean_us,max_us,p50_us,p99_us,vm_steps,fullscan_steps,sorts,autoindexes\n";
+    for (auto const &stats : report())
+    {
+        out << csv_quoted(stats.sql) << ',' << stats.calls << ',' << stats.rows << ','
+            << to_us(stats.total) << ',' << to_us(stats.total) / stats.calls << ',' << to_us(stats.max) << ','
+            << stats.percentile_us(0.5) << ',' << stats.percentile_us(0.99) << ','
+            << stats.vm_steps << ',' << stats.fullscan_steps << ',' << stats.sorts << ',' << stats.autoindexes << '\n';
+    }
+}
+
+void query_profiler::write_json(std::ostream &out) const
+{
+    out << "[";
+    bool first = true;
+    for (auto const &stats : report())
+    {
+        out << (first ? "\n" : ",\n") << "  {\"sql\": " << json_quoted(stats.sql)
+            << ", \"calls\": " << stats.calls << ", \"rows\": " << stats.rows
+            << ", \"total_us\": " << to_us(stats.total) << ", \"mean_us\": " << to_us(stats.total) / stats.calls
+            << ", \"max_us\": " << to_us(stats.max)
+            << ", \"p50_us\": " << stats.percentile_us(0.5) << ", \"p99_us\": " << stats.percentile_us(0.99)
+            << ", \"vm_steps\": " << stats.vm_steps << ", \"fullscan_steps\": " << stats.fullscan_steps
+            << ", \"sorts\": " << stats.sorts << ", \"autoindexes\": " << stats.autoindexes
+            << ", \"histogram_us\": [";
+        for (size_t i = 0; i < query_stats::buckets; ++i)
+        {
+            out << (i == 0 ? "" : ", ") << stats.histogram[i];
+        }
+        out << "]}";
+        first = false;
+    }
+    out << (first ? "]\n" : "\n]\n");
+}
+
+void query_profiler::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.clear();
+}
@@ -0,0 +1,67 @@
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "sqlite3.h"
+
+namespace sqlite_connect
+{
+
+/*
+ * What a query_profiler gathered for one SQL text. Wall times go into
+ * power-of-two microsecond buckets: bucket 0 is below 1us, bucket i is
+ * [2^(i-1), 2^i) us.
+ */
+struct query_stats
+{
+    static constexpr size_t buckets = 32;
+
+    std::string sql;
+    uint64_t calls = 0;
+    uint64_t rows = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds max{0};
+    std::array<uint64_t, buckets> histogram{};
+
+    // sqlite3_stmt_status counters, summed over all calls
+    uint64_t vm_steps = 0;
+    uint64_t fullscan_steps = 0;
+    uint64_t sorts = 0;
+    uint64_t autoindexes = 0;
+
+    // Upper bound in microseconds of the bucket holding the given fraction of calls
+    double percentile_us(double fraction) const;
+};
+
+/*
+ * Collects per-SQL statistics from the connections it is attached to with
+ * connection::set_profiler. A connection without a profiler only pays for
+ * one null check per query. One profiler may be shared by several
+ * connections, e.g. all of a connection_pool.
+ */
+class query_profiler
+{
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, query_stats> m_stats;
+
+public:
+    // stmt may be null for SQL run through sqlite3_exec; its counters are reset after reading
+    void record(const char *sql, std::chrono::nanoseconds elapsed, uint64_t rows, sqlite3_stmt *stmt);
+
+    // All statistics, the most total time first
+    std::vector<query_stats> report() const;
+
+    void write_csv(std::ostream &out) const;
+    void write_json(std::ostream &out) const;
+    void reset();
+};
+
+}; // namespace sqlite_connect
@@ -0,0 +1,244 @@
+
+#include "result_cache.hpp"
+
+using namespace sqlite_connect;
+
+namespace
+{
+
+int collect_tables(void *tables, int action, const char *table, const char *, const char *schema, const char *)
+{
+    if (action == SQLITE_READ && table != nullptr)
+    {
+        static_cast<std::unordered_set<std::string> *>(tables)->insert(std::string(schema ? schema : "main") + "." + table);
+    }
+    return SQLITE_OK;
+}
+
+} // namespace
+
+double result_cache_stats::hit_rate() const
+{
+    uint64_t lookups = hits + misses;
+    return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+}
+
+result_cache::result_cache(connection &db, size_t capacity_bytes, bool watch_other_connections)
+    : m_db(db), m_capacity(capacity_bytes), m_watch_others(watch_other_connections)
+{
+    sqlite3 *handle = static_cast<sqlite3 *>(m_db);
+    sqlite3_update_hook(handle, &result_cache::on_update, this);
+    sqlite3_commit_hook(handle, &result_cache::on_commit, this);
+    sqlite3_rollback_hook(handle, &result_cache::on_rollback, this);
+    m_total_changes = sqlite3_total_changes(handle);
+
+    if (m_watch_others)
+    {
+        m_data_version = std::make_shared<prepared_statement>();
+        m_data_version->prepare(handle, "PRAGMA data_version");
+    }
+}
+
+result_cache::~result_cache()
+{
+    sqlite3 *handle = static_cast<sqlite3 *>(m_db);
+    sqlite3_update_hook(handle, nullptr, nullptr);
+    sqlite3_commit_hook(handle, nullptr, nullptr);
+    sqlite3_rollback_hook(handle, nullptr, nullptr);
+}
+
+void result_cache::on_update(void *self, int, const char *db, const char *table, sqlite3_int64)
+{
+    auto *cache = static_cast<result_cache *>(self);
+    std::string name = std::string(db) + "." + table;
+    ++cache->m_hooked_changes;
+    cache->invalidate(name);
+    cache->m_pending.insert(std::move(name));
+}
+
+int result_cache::on_commit(void *self)
+{
+    auto *cache = static_cast<result_cache *>(self);
+    cache->m_pending.clear();
+    cache->m_pending_unknown = false;
+    return 0;
+}
+
+void result_cache::on_rollback(void *self)
+{
+    auto *cache = static_cast<result_cache *>(self);
+    cache->m_pending.clear();
+    cache->m_pending_unknown = false;
+}
+
+void result_cache::sync()
+{
+    sqlite3 *handle = static_cast<sqlite3 *>(m_db);
+
+    // More changed rows than the update hook reported means some went unseen
+    int total = sqlite3_total_changes(handle);
+    if (static_cast<uint64_t>(total - m_total_changes) != m_hooked_changes)
+    {
+        clear();
+        if (!sqlite3_get_autocommit(handle))
+        {
+            m_pending_unknown = true;
+        }
+    }
+    m_total_changes = total;
+    m_hooked_changes = 0;
+
+    if (m_data_version)
+    {
+        m_data_version->step();
+        long long version = sqlite3_column_int64(*m_data_version, 0);
+        m_data_version->reset();
+        if (version != m_last_data_version)
+        {
+            if (m_last_data_version != -1)
+            {
+                clear();
+            }
+            m_last_data_version = version;
+        }
+    }
+}
+
+std::vector<std::string> const &result_cache::dependencies(const char *sql)
+{
+    auto found = m_dependencies.find(sql);
+    if (found != m_dependencies.end())
+    {
+        return found->second;
+    }
+
+    // Preparing a private copy runs the authorizer, which reports every table read
+    sqlite3 *handle = static_cast<sqlite3 *>(m_db);
+    std::unordered_set<std::string> tables;
+    sqlite3_set_authorizer(handle, &collect_tables, &tables);
+    sqlite3_stmt *stmt = nullptr;
+    int rc = sqlite3_prepare_v2(handle, sql, -1, &stmt, nullptr);
+    sqlite3_set_authorizer(handle, nullptr, nullptr);
+    sqlite3_finalize(stmt);
+    database_exception::throw_on_error(rc);
+
+    return m_dependencies.emplace(sql, std::vector<std::string>(tables.begin(), tables.end())).first->second;
+}
+
+std::shared_ptr<const void> result_cache::lookup(std::string const &key)
+{
+    auto found = m_entries.find(key);
+    if (found == m_entries.end())
+    {
+        ++m_stats.misses;
+        return nullptr;
+    }
+
+    ++m_stats.hits;
+    m_lru.splice(m_lru.begin(), m_lru, found->second);
+    return found->second->rows;
+}
+
+void result_cache::store(std::string key, const char *sql, std::shared_ptr<const void> rows, size_t bytes)
+{
+    std::vector<std::string> const &tables = dependencies(sql);
+    // Nothing would ever invalidate a query that reads no table, e.g. SELECT random()
+    if (tables.empty() || bytes > m_capacity)
+    {
+        return;
+    }
+    if (!sqlite3_get_autocommit(static_cast<sqlite3 *>(m_db)))
+    {
+        if (m_pending_unknown)
+        {
+            return;
+        }
+        for (auto const &table : tables)
+        {
+            if (m_pending.count(table) != 0)
+            {
+                return;
+            }
+        }
+    }
+
+    m_lru.push_front(entry{std::move(key), std::move(rows), bytes, tables});
+    m_entries.emplace(m_lru.front().key, m_lru.begin());
+    for (auto const &table : tables)
+    {
+        m_by_table[table].insert(m_lru.front().key);
+    }
+    m_stats.bytes += bytes;
+
+    while (m_stats.bytes > m_capacity)
+    {
+        ++m_stats.evictions;
+        erase(std::prev(m_lru.end()));
+    }
+}
+
+void result_cache::erase(std::list<entry>::iterator found)
+{
+    for (auto const &table : found->tables)
+    {
+        auto keys = m_by_table.find(table);
+        if (keys != m_by_table.end())
+        {
+            keys->second.erase(found->key);
+            if (keys->second.empty())
+            {
+                m_by_table.erase(keys);
+            }
+        }
+    }
+    m_stats.bytes -= found->bytes;
+    m_entries.erase(found->key);
+    m_lru.erase(found);
+}
+
+void result_cache::invalidate(std::string const &table)
+{
+    auto keys = m_by_table.find(table);
+    if (keys == m_by_table.end())
+    {
+        return;
+    }
+
+    // erase() edits the set, so take the keys out first
+    std::vector<std::string> dropped(keys->second.begin(), keys->second.end());
+    for (auto const &key : dropped)
+    {
+        auto found = m_entries.find(key);
+        if (found != m_entries.end())
+        {
+            ++m_stats.invalidations;
+            erase(found->second);
+        }
+    }
+}
+
+void result_cache::clear()
+{
+    m_stats.invalidations += m_lru.size();
+    m_entries.clear();
+    m_by_table.clear();
+    m_lru.clear();
+    m_stats.bytes = 0;
+}
+
+void result_cache::set_capacity(size_t capacity_bytes)
+{
+    m_capacity = capacity_bytes;
+    while (m_stats.bytes > m_capacity)
+    {
+        ++m_stats.evictions;
+        erase(std::prev(m_lru.end()));
+    }
+}
+
+result_cache_stats result_cache::stats() const
+{
+    result_cache_stats stats = m_stats;
+    stats.entries = m_lru.size();
+    return stats;
+}
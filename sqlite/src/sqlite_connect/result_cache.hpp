@@ -0,0 +1,221 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <typeinfo>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "connection.hpp"
+#include "typed_query.hpp"
+
+namespace sqlite_connect
+{
+
+struct result_cache_stats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Entries dropped because a table they read changed
+    uint64_t invalidations = 0;
+    // Entries dropped to stay within the byte capacity
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+
+    double hit_rate() const;
+};
+
+namespace detail
+{
+
+template <typename Value_T>
+size_t heap_bytes(Value_T const &value)
+{
+    if constexpr (is_optional<Value_T>::value)
+    {
+        return value ? heap_bytes(*value) : 0;
+    }
+    else if constexpr (std::is_same<Value_T, std::string>::value)
+    {
+        return value.capacity();
+    }
+    else
+    {
+        static_assert(!std::is_same<Value_T, std::string_view>::value && !std::is_same<Value_T, std::span<const std::byte>>::value,
+                      "cached rows cannot hold views into the statement");
+        return 0;
+    }
+}
+
+// Appends a bound parameter to a cache key, tagged with its type
+template <typename Value_T>
+void append_key(std::string &key, Value_T const &value)
+{
+    if constexpr (std::is_same<Value_T, std::nullptr_t>::value)
+    {
+        key += 'n';
+    }
+    else if constexpr (std::is_integral<Value_T>::value)
+    {
+        long long integer = static_cast<long long>(value);
+        key += 'i';
+        key.append(reinterpret_cast<const char *>(&integer), sizeof(integer));
+    }
+    else if constexpr (std::is_floating_point<Value_T>::value)
+    {
+        double real = static_cast<double>(value);
+        key += 'd';
+        key.append(reinterpret_cast<const char *>(&real), sizeof(real));
+    }
+    else
+    {
+        bool blob = std::is_convertible<Value_T const &, std::span<const std::byte>>::value;
+        std::string_view bytes;
+        if constexpr (std::is_convertible<Value_T const &, std::span<const std::byte>>::value)
+        {
+            std::span<const std::byte> span(value);
+            bytes = std::string_view(reinterpret_cast<const char *>(span.data()), span.size());
+        }
+        else
+        {
+            bytes = std::string_view(value);
+        }
+        size_t size = bytes.size();
+        key += blob ? 'b' : 't';
+        key.append(reinterpret_cast<const char *>(&size), sizeof(size));
+        key.append(bytes);
+    }
+}
+
+} // namespace detail
+
+/*
+ * Keeps the decoded rows of repeated SELECTs, keyed by the SQL, the bound
+ * parameters and the row type. An entry is dropped as soon as a table it
+ * reads changes. The tables come from the authorizer while the SQL is
+ * prepared once, and changes come from the update, commit and rollback
+ * hooks. Changes the update hook does not see are caught as well: WITHOUT
+ * ROWID tables and DELETE without WHERE show up in sqlite3_total_changes, and
+ * writes by other connections in PRAGMA data_version. Either one clears the
+ * whole cache. Schema changes are not tracked, so call clear() after them.
+ *
+ * Results read inside a transaction that changed their tables are not kept,
+ * because a ROLLBACK TO would make them wrong without any hook firing. Nor
+ * are queries that read no table, such as SELECT random() or datetime('now'),
+ * as no change would ever drop them.
+ *
+ * The cache owns the connection's authorizer and its update, commit and
+ * rollback hooks while it exists. Like the connection, it is for one thread
+ * at a time.
+ */
+class result_cache
+{
+private:
+    struct entry
+    {
+        std::string key;
+        std::shared_ptr<const void> rows;
+        size_t bytes;
+        std::vector<std::string> tables;
+    };
+
+    connection &m_db;
+    size_t m_capacity;
+    bool m_watch_others;
+
+    std::list<entry> m_lru;
+    std::unordered_map<std::string_view, std::list<entry>::iterator> m_entries;
+    std::unordered_map<std::string, std::unordered_set<std::string>> m_by_table;
+    std::unordered_map<std::string, std::vector<std::string>> m_dependencies;
+
+    std::unordered_set<std::string> m_pending;
+    bool m_pending_unknown = false;
+    uint64_t m_hooked_changes = 0;
+    int m_total_changes = 0;
+    std::shared_ptr<prepared_statement> m_data_version;
+    long long m_last_data_version = -1;
+
+    result_cache_stats m_stats;
+
+    static void on_update(void *self, int op, const char *db, const char *table, sqlite3_int64 rowid);
+    static int on_commit(void *self);
+    static void on_rollback(void *self);
+
+    void sync();
+    std::vector<std::string> const &dependencies(const char *sql);
+    std::shared_ptr<const void> lookup(std::string const &key);
+    void store(std::string key, const char *sql, std::shared_ptr<const void> rows, size_t bytes);
+    void erase(std::list<entry>::iterator found);
+
+    template <typename Row_T, typename... Params_T>
+    static std::string make_key(const char *sql, Params_T const &...params)
+    {
+        std::string key(sql);
+        key += '\0';
+        key += typeid(Row_T).name();
+        key += '\0';
+        (detail::append_key(key, params), ...);
+        return key;
+    }
+
+public:
+    explicit result_cache(connection &db, size_t capacity_bytes = 64 * 1024 * 1024, bool watch_other_connections = true);
+    virtual ~result_cache();
+
+    result_cache(result_cache &) = delete;
+    result_cache &operator=(result_cache &) = delete;
+
+    /*
+     * The rows of sql run with params, from the cache when possible:
+     *   auto rows = cache.query<int64_t, std::string>("SELECT id, name FROM tab WHERE x = ?", 3);
+     * Columns must own their data, so no string_view or span.
+     */
+    template <typename... Columns_T, typename... Params_T>
+    std::shared_ptr<const std::vector<std::tuple<Columns_T...>>> query(const char *sql, Params_T const &...params)
+    {
+        return query_as<std::tuple<Columns_T...>, Columns_T...>(sql, params...);
+    }
+
+    // Like query, with every row aggregate-initialized into Row_T
+    template <typename Row_T, typename... Columns_T, typename... Params_T>
+    std::shared_ptr<const std::vector<Row_T>> query_as(const char *sql, Params_T const &...params)
+    {
+        sync();
+        std::string key = make_key<Row_T>(sql, params...);
+        if (auto cached = lookup(key))
+        {
+            return std::static_pointer_cast<const std::vector<Row_T>>(cached);
+        }
+
+        auto rows = std::make_shared<std::vector<Row_T>>();
+        size_t bytes = key.size();
+        for (auto &&columns : sqlite_connect::query<Columns_T...>(m_db, sql, params...))
+        {
+            bytes += sizeof(Row_T);
+            std::apply([&bytes](auto const &...value) { ((bytes += detail::heap_bytes(value)), ...); }, columns);
+            rows->push_back(std::apply([](auto const &...value) { return Row_T{value...}; }, columns));
+        }
+
+        store(std::move(key), sql, rows, bytes);
+        return rows;
+    }
+
+    // Drops the entries that read table, given as "schema.table"
+    void invalidate(std::string const &table);
+    void clear();
+
+    void set_capacity(size_t capacity_bytes);
+    result_cache_stats stats() const;
+};
+
+}; // namespace sqlite_connect
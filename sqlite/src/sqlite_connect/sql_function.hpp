@@ -0,0 +1,278 @@
+
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "sqlite3.h"
+
+namespace sqlite_connect
+{
+
+namespace detail
+{
+
+template <typename T>
+struct is_optional : std::false_type
+{
+};
+
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type
+{
+};
+
+template <typename T>
+struct dependent_false : std::false_type
+{
+};
+
+// Return and argument types of a lambda, functor or function pointer
+template <typename F>
+struct callable_traits : callable_traits<decltype(&F::operator())>
+{
+};
+
+template <typename R, typename... Args_T>
+struct callable_traits<R (*)(Args_T...)>
+{
+    using result = R;
+    using arguments = std::tuple<std::decay_t<Args_T>...>;
+};
+
+template <typename C, typename R, typename... Args_T>
+struct callable_traits<R (C::*)(Args_T...)> : callable_traits<R (*)(Args_T...)>
+{
+};
+
+template <typename C, typename R, typename... Args_T>
+struct callable_traits<R (C::*)(Args_T...) const> : callable_traits<R (*)(Args_T...)>
+{
+};
+
+// Reads a function argument as Value_T, chosen at compile time
+template <typename Value_T>
+Value_T read_value(sqlite3_value *value)
+{
+    if constexpr (std::is_same<Value_T, sqlite3_value *>::value)
+    {
+        return value;
+    }
+    else if constexpr (is_optional<Value_T>::value)
+    {
+        if (sqlite3_value_type(value) == SQLITE_NULL)
+        {
+            return std::nullopt;
+        }
+        return read_value<typename Value_T::value_type>(value);
+    }
+    else if constexpr (std::is_same<Value_T, bool>::value)
+    {
+        return sqlite3_value_int(value) != 0;
+    }
+    else if constexpr (std::is_integral<Value_T>::value)
+    {
+        return static_cast<Value_T>(sqlite3_value_int64(value));
+    }
+    else if constexpr (std::is_floating_point<Value_T>::value)
+    {
+        return static_cast<Value_T>(sqlite3_value_double(value));
+    }
+    else if constexpr (std::is_same<Value_T, std::string>::value || std::is_same<Value_T, std::string_view>::value)
+    {
+        const char *text = reinterpret_cast<const char *>(sqlite3_value_text(value));
+        return text == nullptr ? Value_T() : Value_T(text, static_cast<size_t>(sqlite3_value_bytes(value)));
+    }
+    else if constexpr (std::is_same<Value_T, std::span<const std::byte>>::value)
+    {
+        const std::byte *blob = static_cast<const std::byte *>(sqlite3_value_blob(value));
+        return blob == nullptr ? Value_T() : Value_T(blob, static_cast<size_t>(sqlite3_value_bytes(value)));
+    }
+    else
+    {
+        static_assert(dependent_false<Value_T>::value, "unsupported argument type");
+    }
+}
+
+// Sets the function result from a C++ value, chosen at compile time
+template <typename Value_T>
+void set_result(sqlite3_context *ctx, Value_T const &value)
+{
+    if constexpr (std::is_same<Value_T, std::nullptr_t>::value)
+    {
+        sqlite3_result_null(ctx);
+    }
+    else if constexpr (is_optional<Value_T>::value)
+    {
+        if (value)
+        {
+            set_result(ctx, *value);
+        }
+        else
+        {
+            sqlite3_result_null(ctx);
+        }
+    }
+    else if constexpr (std::is_integral<Value_T>::value)
+    {
+        sqlite3_result_int64(ctx, static_cast<sqlite3_int64>(value));
+    }
+    else if constexpr (std::is_floating_point<Value_T>::value)
+    {
+        sqlite3_result_double(ctx, static_cast<double>(value));
+    }
+    else if constexpr (std::is_convertible<Value_T const &, std::string_view>::value)
+    {
+        std::string_view text(value);
+        sqlite3_result_text64(ctx, text.data(), text.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+    }
+    else if constexpr (std::is_convertible<Value_T const &, std::span<const std::byte>>::value)
+    {
+        std::span<const std::byte> blob(value);
+        sqlite3_result_blob64(ctx, blob.data(), blob.size(), SQLITE_TRANSIENT);
+    }
+    else
+    {
+        static_assert(dependent_false<Value_T>::value, "unsupported result type");
+    }
+}
+
+template <typename F, typename Args_T, size_t... I>
+decltype(auto) invoke_with_values(F &f, sqlite3_value **values, std::index_sequence<I...>)
+{
+    return f(read_value<std::tuple_element_t<I, Args_T>>(values[I])...);
+}
+
+template <typename F, typename State_T, typename Args_T, size_t... I>
+void invoke_step(F &f, State_T &state, sqlite3_value **values, std::index_sequence<I...>)
+{
+    f(state, read_value<std::tuple_element_t<I + 1, Args_T>>(values[I])...);
+}
+
+template <typename F>
+void scalar_function(sqlite3_context *ctx, int, sqlite3_value **values)
+{
+    using traits = callable_traits<F>;
+    using arguments = typename traits::arguments;
+    F &f = *static_cast<F *>(sqlite3_user_data(ctx));
+    auto sequence = std::make_index_sequence<std::tuple_size<arguments>::value>();
+
+    try
+    {
+        if constexpr (std::is_void<typename traits::result>::value)
+        {
+            invoke_with_values<F, arguments>(f, values, sequence);
+            sqlite3_result_null(ctx);
+        }
+        else
+        {
+            set_result(ctx, invoke_with_values<F, arguments>(f, values, sequence));
+        }
+    }
+    catch (std::bad_alloc const &)
+    {
+        sqlite3_result_error_nomem(ctx);
+    }
+    catch (std::exception const &e)
+    {
+        sqlite3_result_error(ctx, e.what(), -1);
+    }
+}
+
+/*
+ * The per-group state lives in the memory of sqlite3_aggregate_context,
+ * which SQLite zeroes on allocation, so constructed starts out false.
+ */
+template <typename State_T>
+struct aggregate_slot
+{
+    bool constructed;
+    State_T state;
+};
+
+template <typename Step_T, typename Final_T>
+struct aggregate_functions
+{
+    Step_T step;
+    Final_T final;
+};
+
+template <typename State_T, typename Step_T, typename Final_T>
+void aggregate_step(sqlite3_context *ctx, int, sqlite3_value **values)
+{
+    using arguments = typename callable_traits<Step_T>::arguments;
+    auto &functions = *static_cast<aggregate_functions<Step_T, Final_T> *>(sqlite3_user_data(ctx));
+
+    auto *slot = static_cast<aggregate_slot<State_T> *>(sqlite3_aggregate_context(ctx, sizeof(aggregate_slot<State_T>)));
+    if (slot == nullptr)
+    {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+
+    try
+    {
+        if (!slot->constructed)
+        {
+            new (&slot->state) State_T();
+            slot->constructed = true;
+        }
+        invoke_step<Step_T, State_T, arguments>(functions.step, slot->state, values,
+                                                 std::make_index_sequence<std::tuple_size<arguments>::value - 1>());
+    }
+    catch (std::bad_alloc const &)
+    {
+        sqlite3_result_error_nomem(ctx);
+    }
+    catch (std::exception const &e)
+    {
+        sqlite3_result_error(ctx, e.what(), -1);
+    }
+}
+
+template <typename State_T, typename Step_T, typename Final_T>
+void aggregate_final(sqlite3_context *ctx)
+{
+    auto &functions = *static_cast<aggregate_functions<Step_T, Final_T> *>(sqlite3_user_data(ctx));
+
+    // Without any step, e.g. over no rows, there is no context to allocate
+    auto *slot = static_cast<aggregate_slot<State_T> *>(sqlite3_aggregate_context(ctx, 0));
+    State_T empty{};
+    State_T &state = slot != nullptr && slot->constructed ? slot->state : empty;
+
+    try
+    {
+        set_result(ctx, functions.final(state));
+    }
+    catch (std::bad_alloc const &)
+    {
+        sqlite3_result_error_nomem(ctx);
+    }
+    catch (std::exception const &e)
+    {
+        sqlite3_result_error(ctx, e.what(), -1);
+    }
+
+    if (slot != nullptr && slot->constructed)
+    {
+        slot->state.~State_T();
+        slot->constructed = false;
+    }
+}
+
+template <typename T>
+void destroy_user_data(void *data)
+{
+    delete static_cast<T *>(data);
+}
+
+} // namespace detail
+
+}; // namespace sqlite_connect
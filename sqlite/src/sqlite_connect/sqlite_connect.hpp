@@ -1,5 +1,18 @@
 #include "database_exception.hpp"
 #include "prepared_statement.hpp"
+#include "statement_cache.hpp"
+#include "connection_options.hpp"
+#include "query_profiler.hpp"
 #include "iquery.hpp"
 #include "connection.hpp"
+#include "connection_pool.hpp"
+#include "bulk_insert.hpp"
+#include "typed_query.hpp"
+#include "columnar_reader.hpp"
+#include "blob_streambuf.hpp"
+#include "vector_table.hpp"
+#include "backup.hpp"
+#include "result_cache.hpp"
+#include "async_executor.hpp"
+#include "group_commit_writer.hpp"
 #include "transaction.hpp"
\ No newline at end of file
@@ -0,0 +1,84 @@
+
+#include "statement_cache.hpp"
+
+using namespace sqlite_connect;
+
+statement_cache::statement_cache(size_t capacity) : m_capacity(capacity)
+{
+}
+
+auto statement_cache::acquire(sqlite3 *db, const char *sql) -> statement_ptr
+{
+    auto found = m_index.find(std::string_view(sql));
+
+    if (found != m_index.end() && found->second->statement.use_count() == 1)
+    {
+        ++m_hits;
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+
+        statement_ptr statement = found->second->statement;
+        try
+        {
+            statement->reset();
+        }
+        catch (database_exception const &)
+        {
+            // reset repeats the error of the last step, which was reported to that caller
+        }
+        statement->clear_bindings();
+        return statement;
+    }
+
+    ++m_misses;
+    auto statement = std::make_shared<prepared_statement>();
+    statement->prepare(db, sql);
+
+    if (found == m_index.end() && m_capacity > 0)
+    {
+        evict_to(m_capacity - 1);
+        m_entries.push_front(entry{sql, statement});
+        m_index.emplace(std::string_view(m_entries.front().sql), m_entries.begin());
+    }
+    return statement;
+}
+
+void statement_cache::evict_to(size_t size)
+{
+    while (m_entries.size() > size)
+    {
+        m_index.erase(std::string_view(m_entries.back().sql));
+        m_entries.pop_back();
+    }
+}
+
+void statement_cache::set_capacity(size_t capacity)
+{
+    m_capacity = capacity;
+    evict_to(m_capacity);
+}
+
+size_t statement_cache::capacity() const
+{
+    return m_capacity;
+}
+
+size_t statement_cache::size() const
+{
+    return m_entries.size();
+}
+
+size_t statement_cache::hits() const
+{
+    return m_hits;
+}
+
+size_t statement_cache::misses() const
+{
+    return m_misses;
+}
+
+void statement_cache::clear()
+{
+    m_index.clear();
+    m_entries.clear();
+}
@@ -0,0 +1,54 @@
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "prepared_statement.hpp"
+
+namespace sqlite_connect
+{
+
+/*
+ * The prepared statements of one connection keyed by their SQL text, with
+ * the least recently used one dropped when the cache is full. A statement is
+ * reset and its bindings cleared when it is handed out. If a statement is
+ * still held by an earlier caller, a fresh uncached one is prepared instead.
+ */
+class statement_cache
+{
+public:
+    using statement_ptr = std::shared_ptr<prepared_statement>;
+
+private:
+    struct entry
+    {
+        std::string sql;
+        statement_ptr statement;
+    };
+
+    // Most recently used first, the index keys are views of entry::sql
+    std::list<entry> m_entries;
+    std::unordered_map<std::string_view, std::list<entry>::iterator> m_index;
+    size_t m_capacity;
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+
+    void evict_to(size_t size);
+
+public:
+    explicit statement_cache(size_t capacity = 64);
+
+    statement_ptr acquire(sqlite3 *db, const char *sql);
+
+    void set_capacity(size_t capacity);
+    size_t capacity() const;
+    size_t size() const;
+    size_t hits() const;
+    size_t misses() const;
+    void clear();
+};
+
+}; // namespace sqlite_connect
@@ -1,23 +1,56 @@
 
 #include "transaction.hpp"
+#include <atomic>
+#include <exception>
 
 using namespace sqlite_connect;
 
-transaction::transaction(std::shared_ptr<connection> db)
-    : m_db(db)
+namespace
+{
+
+std::string next_savepoint_name()
+{
+    static std::atomic<unsigned long> counter{0};
+    return "sqlite_connect_" + std::to_string(counter.fetch_add(1));
+}
+
+} // namespace
+
+transaction::transaction(std::shared_ptr<connection> db, on_exit exit)
+    : m_db(db), m_name(next_savepoint_name()), m_on_exit(exit), m_uncaught(std::uncaught_exceptions())
 {
     start_transaction();
 }
 
 transaction::~transaction()
 {
+    if (!m_active)
+    {
+        return;
+    }
+
+    bool rolling_back = std::uncaught_exceptions() > m_uncaught || m_on_exit == on_exit::ROLLBACK;
+    if (!rolling_back)
+    {
+        try
+        {
+            end_transaction();
+            return;
+        }
+        catch (std::exception const &e)
+        {
+            // An open savepoint would keep the transaction and its locks after the scope
+            std::cerr << "Transaction commit error, rolling back: " << e.what() << "\n";
+        }
+    }
+
     try
     {
-        end_transaction();
+        rollback_transaction();
     }
     catch (std::exception const &e)
     {
-        std::cerr << "Transaction commit error: " << e.what() << "\n";
+        std::cerr << "Transaction rollback error: " << e.what() << "\n";
     }
 }
 
@@ -34,23 +67,76 @@ void transaction::execute_sql(const char *sql)
     }
 }
 
+void transaction::execute_sql(std::string const &sql)
+{
+    execute_sql(sql.c_str());
+}
+
 void transaction::start_transaction()
 {
-    this->execute_sql("BEGIN TRANSACTION");
+    std::shared_ptr<connection> db = m_db.lock();
+    m_outermost = db && sqlite3_get_autocommit(static_cast<sqlite3 *>(*db));
+    this->execute_sql("SAVEPOINT " + m_name);
+    m_active = true;
 }
 
 void transaction::end_transaction()
 {
-    this->execute_sql("END TRANSACTION");
+    // A failed release, e.g. a busy commit, leaves the savepoint open
+    this->execute_sql("RELEASE SAVEPOINT " + m_name);
+    m_active = false;
 }
 
 void transaction::rollback_transaction()
 {
-    this->execute_sql("ROLLBACK TRANSACTION");
+    m_active = false;
+
+    // Some errors make SQLite roll back the whole transaction by itself
+    std::shared_ptr<connection> db = m_db.lock();
+    if (db && sqlite3_get_autocommit(static_cast<sqlite3 *>(*db)))
+    {
+        return;
+    }
+    // Releasing an outermost savepoint commits, which needs the locks a busy commit could not get
+    if (m_outermost)
+    {
+        this->execute_sql("ROLLBACK");
+        return;
+    }
+    this->execute_sql("ROLLBACK TO SAVEPOINT " + m_name);
+    this->execute_sql("RELEASE SAVEPOINT " + m_name);
+}
+
+void transaction::commit()
+{
+    if (!m_active)
+    {
+        throw database_exception("Transaction is already finished");
+    }
+    end_transaction();
+}
+
+void transaction::rollback()
+{
+    if (!m_active)
+    {
+        throw database_exception("Transaction is already finished");
+    }
+    rollback_transaction();
+}
+
+bool transaction::is_active() const
+{
+    return m_active;
 }
 
 void transaction::execute_query(iquery &q)
 {
+    if (!m_active)
+    {
+        throw database_exception("Transaction is already finished");
+    }
+
     std::shared_ptr<connection> db;
     if (db = m_db.lock())
     {
@@ -58,11 +144,18 @@ void transaction::execute_query(iquery &q)
         {
             db->execute_query(q);
         }
-        catch (database_exception const &e)
+        catch (database_exception const &)
         {
-            this->rollback_transaction();
+            try
+            {
+                this->rollback_transaction();
+            }
+            catch (database_exception const &)
+            {
+                // The original error is the one worth reporting
+            }
 
-            throw e;
+            throw;
         }
     }
 }
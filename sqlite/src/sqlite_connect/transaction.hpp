@@ -2,26 +2,63 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include "connection.hpp"
 #include <iostream>
 
 namespace sqlite_connect
 {
 
+/*
+ * A savepoint on the connection. The outermost one begins the transaction
+ * and releasing it commits; one opened while another transaction is running
+ * nests inside it, so library code can add its work to the caller's
+ * transaction instead of committing on its own.
+ *
+ * Leaving the scope while an exception unwinds always rolls back. Otherwise
+ * on_exit decides what happens to a transaction that was neither committed
+ * nor rolled back explicitly; if that commit fails, e.g. with SQLITE_BUSY,
+ * it is rolled back so the savepoint does not outlive the scope. A failing
+ * execute_query rolls the transaction back before rethrowing.
+ */
 class transaction
 {
+public:
+    enum class on_exit
+    {
+        COMMIT,
+        ROLLBACK
+    };
+
 private:
     std::weak_ptr<connection> m_db;
+    std::string m_name;
+    on_exit m_on_exit;
+    int m_uncaught;
+    bool m_active = false;
+    // Began the transaction rather than nesting in one
+    bool m_outermost = false;
 
     void execute_sql(const char *sql);
+    void execute_sql(std::string const &sql);
     void start_transaction();
     void end_transaction();
     void rollback_transaction();
 
 public:
-    transaction(std::shared_ptr<connection> db);
+    transaction(std::shared_ptr<connection> db, on_exit exit = on_exit::COMMIT);
     virtual ~transaction();
 
+    transaction(transaction &) = delete;
+    transaction &operator=(transaction &) = delete;
+
     void execute_query(iquery &q);
+
+    // Releases the savepoint, which commits if this is the outermost one
+    void commit();
+    // Undoes everything done since the savepoint and releases it
+    void rollback();
+
+    bool is_active() const;
 };
 }; // namespace sqlite_connect
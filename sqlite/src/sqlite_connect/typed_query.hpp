@@ -0,0 +1,242 @@
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "connection.hpp"
+#include "prepared_statement.hpp"
+#include "sql_function.hpp"
+
+namespace sqlite_connect
+{
+
+namespace detail
+{
+
+// Reads column i of the current row as Column_T, chosen at compile time
+template <typename Column_T>
+Column_T read_column(sqlite3_stmt *stmt, int i)
+{
+    if constexpr (is_optional<Column_T>::value)
+    {
+        if (sqlite3_column_type(stmt, i) == SQLITE_NULL)
+        {
+            return std::nullopt;
+        }
+        return read_column<typename Column_T::value_type>(stmt, i);
+    }
+    else if constexpr (std::is_same<Column_T, bool>::value)
+    {
+        return sqlite3_column_int(stmt, i) != 0;
+    }
+    else if constexpr (std::is_integral<Column_T>::value)
+    {
+        if constexpr (sizeof(Column_T) < sizeof(int) || (sizeof(Column_T) == sizeof(int) && std::is_signed<Column_T>::value))
+        {
+            return static_cast<Column_T>(sqlite3_column_int(stmt, i));
+        }
+        else
+        {
+            return static_cast<Column_T>(sqlite3_column_int64(stmt, i));
+        }
+    }
+    else if constexpr (std::is_floating_point<Column_T>::value)
+    {
+        return static_cast<Column_T>(sqlite3_column_double(stmt, i));
+    }
+    else if constexpr (std::is_same<Column_T, std::string>::value || std::is_same<Column_T, std::string_view>::value)
+    {
+        const char *text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, i));
+        return text == nullptr ? Column_T() : Column_T(text, static_cast<size_t>(sqlite3_column_bytes(stmt, i)));
+    }
+    else if constexpr (std::is_same<Column_T, std::span<const std::byte>>::value)
+    {
+        const std::byte *blob = static_cast<const std::byte *>(sqlite3_column_blob(stmt, i));
+        return blob == nullptr ? Column_T() : Column_T(blob, static_cast<size_t>(sqlite3_column_bytes(stmt, i)));
+    }
+    else
+    {
+        static_assert(dependent_false<Column_T>::value, "unsupported column type");
+    }
+}
+
+// Column types that point into the current row instead of owning their data
+template <typename Column_T>
+struct is_row_view : std::bool_constant<std::is_same<Column_T, std::string_view>::value || std::is_same<Column_T, std::span<const std::byte>>::value>
+{
+};
+
+template <typename Column_T>
+struct is_row_view<std::optional<Column_T>> : is_row_view<Column_T>
+{
+};
+
+} // namespace detail
+
+/*
+ * The rows of a statement as an input range of Row_T, each built from the
+ * columns read as Columns_T. Column types are fixed at compile time and the
+ * column count is checked once, so decoding a row is only the sqlite3_column
+ * calls. string_view and span columns point into the current row and are
+ * only valid until the range moves on.
+ */
+template <typename Row_T, typename... Columns_T>
+class row_range
+{
+private:
+    std::shared_ptr<prepared_statement> m_stmt;
+    std::optional<Row_T> m_row;
+    bool m_started = false;
+
+    template <size_t... I>
+    Row_T decode(std::index_sequence<I...>)
+    {
+        sqlite3_stmt *stmt = *m_stmt;
+        return Row_T{detail::read_column<Columns_T>(stmt, static_cast<int>(I))...};
+    }
+
+    bool advance()
+    {
+        if (!m_stmt->step())
+        {
+            m_row.reset();
+            return false;
+        }
+        m_row.emplace(decode(std::index_sequence_for<Columns_T...>{}));
+        return true;
+    }
+
+    void start()
+    {
+        if (!m_started)
+        {
+            m_started = true;
+            advance();
+        }
+    }
+
+public:
+    class iterator
+    {
+    private:
+        row_range *m_range = nullptr;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Row_T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Row_T const *;
+        using reference = Row_T const &;
+
+        iterator() = default;
+        explicit iterator(row_range *range) : m_range(range) {}
+
+        reference operator*() const { return *m_range->m_row; }
+        pointer operator->() const { return &*m_range->m_row; }
+
+        iterator &operator++()
+        {
+            m_range->advance();
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const { return !m_range->m_row.has_value(); }
+    };
+
+    explicit row_range(std::shared_ptr<prepared_statement> stmt) : m_stmt(std::move(stmt))
+    {
+        if (static_cast<size_t>(sqlite3_column_count(*m_stmt)) < sizeof...(Columns_T))
+        {
+            throw database_exception("Query returns fewer columns than requested");
+        }
+    }
+
+    ~row_range()
+    {
+        // Ends the read now instead of when the cached statement is reused, and records it if unfinished
+        if (m_stmt)
+        {
+            try
+            {
+                m_stmt->reset();
+            }
+            catch (database_exception const &)
+            {
+                // The failed step already threw this error
+            }
+        }
+    }
+
+    row_range(row_range &&) = default;
+    row_range &operator=(row_range &&) = default;
+
+    iterator begin()
+    {
+        start();
+        return iterator(this);
+    }
+
+    std::default_sentinel_t end() const
+    {
+        return std::default_sentinel;
+    }
+
+    // Appends the remaining rows to output, reserve ahead for large results. Columns must own their data
+    void fill(std::vector<Row_T> &output)
+    {
+        static_assert(!(detail::is_row_view<Columns_T>::value || ...), "collected rows cannot hold views into the statement");
+        start();
+        while (m_row)
+        {
+            output.push_back(std::move(*m_row));
+            advance();
+        }
+    }
+
+    std::vector<Row_T> to_vector(size_t reserve = 0)
+    {
+        std::vector<Row_T> output;
+        output.reserve(reserve);
+        fill(output);
+        return output;
+    }
+};
+
+/*
+ * Runs sql with params bound in order and returns its rows as tuples:
+ *   for (auto [id, x] : query<int64_t, int>(db, "SELECT id, x FROM tab WHERE y > ?", 2.0))
+ */
+template <typename... Columns_T, typename... Params_T>
+row_range<std::tuple<Columns_T...>, Columns_T...> query(connection &db, const char *sql, Params_T const &...params)
+{
+    auto stmt = db.prepare(sql);
+    size_t i = 1;
+    (stmt->bind_value(i++, params), ...);
+    return row_range<std::tuple<Columns_T...>, Columns_T...>(std::move(stmt));
+}
+
+/*
+ * Like query, with every row aggregate-initialized into Row_T:
+ *   query_as<record, int64_t, int, double>(db, "SELECT id, x, y FROM tab").to_vector(n)
+ */
+template <typename Row_T, typename... Columns_T, typename... Params_T>
+row_range<Row_T, Columns_T...> query_as(connection &db, const char *sql, Params_T const &...params)
+{
+    auto stmt = db.prepare(sql);
+    size_t i = 1;
+    (stmt->bind_value(i++, params), ...);
+    return row_range<Row_T, Columns_T...>(std::move(stmt));
+}
+
+}; // namespace sqlite_connect
@@ -0,0 +1,581 @@
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "connection.hpp"
+#include "database_exception.hpp"
+#include "sql_function.hpp"
+#include "sqlite3.h"
+
+namespace sqlite_connect
+{
+
+/*
+ * A column of a vector table: its SQL name and how to read it from a
+ * record, as a member pointer or any callable taking the record. A sorted
+ * column promises that the rows are in ascending order of it, which lets
+ * equality and range constraints on it binary-search the rows.
+ */
+template <typename Accessor_T>
+struct table_column
+{
+    const char *name;
+    Accessor_T accessor;
+    bool sorted;
+};
+
+template <typename Accessor_T>
+table_column<Accessor_T> column(const char *name, Accessor_T accessor)
+{
+    return table_column<Accessor_T>{name, accessor, false};
+}
+
+template <typename Accessor_T>
+table_column<Accessor_T> sorted_column(const char *name, Accessor_T accessor)
+{
+    return table_column<Accessor_T>{name, accessor, true};
+}
+
+namespace detail
+{
+
+// idxNum bits from xBestIndex to xFilter, the key column is above them
+enum vector_table_plan
+{
+    PLAN_EQ = 1,
+    PLAN_LOWER = 2,
+    PLAN_LOWER_STRICT = 4,
+    PLAN_UPPER = 8,
+    PLAN_UPPER_STRICT = 16,
+    PLAN_COLUMN_SHIFT = 8
+};
+
+template <typename Record_T, typename Accessor_T>
+using accessor_result = std::invoke_result_t<Accessor_T const &, Record_T const &>;
+
+template <typename Value_T>
+const char *declared_type()
+{
+    if constexpr (is_optional<Value_T>::value)
+    {
+        return declared_type<typename Value_T::value_type>();
+    }
+    else if constexpr (std::is_integral<Value_T>::value)
+    {
+        return "INTEGER";
+    }
+    else if constexpr (std::is_floating_point<Value_T>::value)
+    {
+        return "REAL";
+    }
+    else if constexpr (std::is_convertible<Value_T const &, std::string_view>::value)
+    {
+        return "TEXT";
+    }
+    else if constexpr (std::is_convertible<Value_T const &, std::span<const std::byte>>::value)
+    {
+        return "BLOB";
+    }
+    else
+    {
+        static_assert(dependent_false<Value_T>::value, "unsupported column type");
+    }
+}
+
+/*
+ * Text and blobs that live in the container are handed to SQLite without a
+ * copy; values an accessor computes on the fly are copied.
+ */
+template <bool Stable_V, typename Value_T>
+void set_column_result(sqlite3_context *ctx, Value_T const &value)
+{
+    if constexpr (is_optional<Value_T>::value)
+    {
+        if (value)
+        {
+            set_column_result<Stable_V>(ctx, *value);
+        }
+        else
+        {
+            sqlite3_result_null(ctx);
+        }
+    }
+    else if constexpr (Stable_V && !std::is_arithmetic<Value_T>::value &&
+                       std::is_convertible<Value_T const &, std::string_view>::value)
+    {
+        std::string_view text(value);
+        sqlite3_result_text64(ctx, text.data(), text.size(), SQLITE_STATIC, SQLITE_UTF8);
+    }
+    else if constexpr (Stable_V && std::is_convertible<Value_T const &, std::span<const std::byte>>::value)
+    {
+        std::span<const std::byte> blob(value);
+        sqlite3_result_blob64(ctx, blob.data(), blob.size(), SQLITE_STATIC);
+    }
+    else
+    {
+        set_result(ctx, value);
+    }
+}
+
+// Types compare_key handles; a sorted column of any other type is scanned
+template <typename Key_T>
+constexpr bool is_key_type = std::is_arithmetic<Key_T>::value ||
+                             std::is_convertible<Key_T const &, std::string_view>::value ||
+                             std::is_convertible<Key_T const &, std::span<const std::byte>>::value;
+
+template <typename T>
+int three_way(T const &a, T const &b)
+{
+    return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+template <typename Key_T>
+constexpr bool is_text_key = !std::is_arithmetic<Key_T>::value && std::is_convertible<Key_T const &, std::string_view>::value;
+
+/*
+ * Compares a key with an SQL value as SQLite would: numbers, then text, then
+ * blobs. An INTEGER or REAL column gives its numeric affinity to the other
+ * operand, so text such as '10' is compared as the number it spells.
+ */
+template <typename Key_T>
+int compare_key(Key_T const &key, sqlite3_value *value)
+{
+    int type = std::is_arithmetic<Key_T>::value ? sqlite3_value_numeric_type(value) : sqlite3_value_type(value);
+    if constexpr (std::is_integral<Key_T>::value)
+    {
+        if (type == SQLITE_INTEGER)
+        {
+            return three_way<sqlite3_int64>(static_cast<sqlite3_int64>(key), sqlite3_value_int64(value));
+        }
+        if (type == SQLITE_FLOAT)
+        {
+            return three_way<double>(static_cast<double>(key), sqlite3_value_double(value));
+        }
+        return -1;
+    }
+    else if constexpr (std::is_floating_point<Key_T>::value)
+    {
+        if (type == SQLITE_INTEGER || type == SQLITE_FLOAT)
+        {
+            return three_way<double>(static_cast<double>(key), sqlite3_value_double(value));
+        }
+        return -1;
+    }
+    else if constexpr (std::is_convertible<Key_T const &, std::string_view>::value)
+    {
+        // Not reached for numbers, bounds_rows leaves those to SQLite
+        if (type == SQLITE_INTEGER || type == SQLITE_FLOAT)
+        {
+            return 1;
+        }
+        if (type == SQLITE_TEXT)
+        {
+            std::string_view text = read_value<std::string_view>(value);
+            int order = std::string_view(key).compare(text);
+            return order < 0 ? -1 : (order > 0 ? 1 : 0);
+        }
+        return -1;
+    }
+    else if constexpr (std::is_convertible<Key_T const &, std::span<const std::byte>>::value)
+    {
+        if (type != SQLITE_BLOB)
+        {
+            return 1;
+        }
+        std::span<const std::byte> a(key);
+        std::span<const std::byte> b = read_value<std::span<const std::byte>>(value);
+        int order = std::memcmp(a.data(), b.data(), std::min(a.size(), b.size()));
+        return order != 0 ? (order < 0 ? -1 : 1) : three_way(a.size(), b.size());
+    }
+    else
+    {
+        static_assert(dependent_false<Key_T>::value, "unsupported sorted column type");
+    }
+}
+
+/*
+ * Whether value can bound the rows of a key column. A number compared with a
+ * TEXT column is converted to text or the column to a number depending on
+ * the affinity of the number's side, which xFilter cannot see, so such a
+ * value leaves the rows to SQLite's own check.
+ */
+template <typename Key_T>
+bool bounds_rows(sqlite3_value *value)
+{
+    int type = sqlite3_value_type(value);
+    return !is_text_key<Key_T> || (type != SQLITE_INTEGER && type != SQLITE_FLOAT);
+}
+
+template <typename Tuple_T, typename F, size_t... I>
+void visit_column(Tuple_T const &columns, int i, F &&f, std::index_sequence<I...>)
+{
+    ((i == static_cast<int>(I) ? (f(std::get<I>(columns)), true) : false) || ...);
+}
+
+template <typename Record_T, typename... Accessors_T>
+class vector_table_module
+{
+private:
+    using columns_type = std::tuple<table_column<Accessors_T>...>;
+    using sequence = std::index_sequence_for<Accessors_T...>;
+
+    struct table : sqlite3_vtab
+    {
+        vector_table_module *module;
+    };
+
+    struct cursor : sqlite3_vtab_cursor
+    {
+        size_t position;
+        size_t end;
+    };
+
+    std::span<const Record_T> m_rows;
+    columns_type m_columns;
+    std::string m_schema;
+    sqlite3_module m_module{};
+
+    template <typename F>
+    void visit(int i, F &&f) const
+    {
+        visit_column(m_columns, i, std::forward<F>(f), sequence());
+    }
+
+    bool is_sorted(int i) const
+    {
+        bool sorted = false;
+        visit(i, [&sorted](auto const &column) {
+            using key = std::decay_t<accessor_result<Record_T, decltype(column.accessor)>>;
+            sorted = column.sorted && is_key_type<key>;
+        });
+        return sorted;
+    }
+
+    // Constraints on a TEXT column are checked again by SQLite, see bounds_rows
+    bool is_exact(int i) const
+    {
+        bool exact = true;
+        visit(i, [&exact](auto const &column) {
+            exact = !is_text_key<std::decay_t<accessor_result<Record_T, decltype(column.accessor)>>>;
+        });
+        return exact;
+    }
+
+    static vector_table_module &owner(sqlite3_vtab *vtab)
+    {
+        return *static_cast<table *>(vtab)->module;
+    }
+
+    static int connect(sqlite3 *db, void *data, int, const char *const *, sqlite3_vtab **out, char **)
+    {
+        auto *module = static_cast<vector_table_module *>(data);
+        int rc = sqlite3_declare_vtab(db, module->m_schema.c_str());
+        if (rc != SQLITE_OK)
+        {
+            return rc;
+        }
+
+        auto *vtab = new (std::nothrow) table();
+        if (vtab == nullptr)
+        {
+            return SQLITE_NOMEM;
+        }
+        vtab->module = module;
+        *out = vtab;
+        return SQLITE_OK;
+    }
+
+    static int disconnect(sqlite3_vtab *vtab)
+    {
+        delete static_cast<table *>(vtab);
+        return SQLITE_OK;
+    }
+
+    static int best_index(sqlite3_vtab *vtab, sqlite3_index_info *info)
+    {
+        vector_table_module &module = owner(vtab);
+        double rows = static_cast<double>(std::max<size_t>(module.m_rows.size(), 1));
+
+        // Pick a sorted column, preferring one with an equality constraint
+        int key = -1, eq = -1, lower = -1, upper = -1;
+        for (int pass = 0; pass < 2 && eq < 0; ++pass)
+        {
+            for (int i = 0; i < info->nConstraint; ++i)
+            {
+                auto const &constraint = info->aConstraint[i];
+                if (!constraint.usable || !module.is_sorted(constraint.iColumn))
+                {
+                    continue;
+                }
+                const char *collation = sqlite3_vtab_collation(info, i);
+                if (collation != nullptr && sqlite3_stricmp(collation, "BINARY") != 0)
+                {
+                    continue;
+                }
+
+                bool is_eq = constraint.op == SQLITE_INDEX_CONSTRAINT_EQ;
+                bool is_lower = constraint.op == SQLITE_INDEX_CONSTRAINT_GT || constraint.op == SQLITE_INDEX_CONSTRAINT_GE;
+                bool is_upper = constraint.op == SQLITE_INDEX_CONSTRAINT_LT || constraint.op == SQLITE_INDEX_CONSTRAINT_LE;
+                if (pass == 0 ? !is_eq : !(is_lower || is_upper))
+                {
+                    continue;
+                }
+                if (key < 0)
+                {
+                    key = constraint.iColumn;
+                }
+                if (constraint.iColumn != key)
+                {
+                    continue;
+                }
+
+                if (is_eq && eq < 0)
+                {
+                    eq = i;
+                }
+                else if (is_lower && lower < 0)
+                {
+                    lower = i;
+                }
+                else if (is_upper && upper < 0)
+                {
+                    upper = i;
+                }
+            }
+        }
+
+        int plan = 0, argv = 0;
+        unsigned char omit = key >= 0 && module.is_exact(key) ? 1 : 0;
+        if (eq >= 0)
+        {
+            plan |= PLAN_EQ;
+            info->aConstraintUsage[eq].argvIndex = ++argv;
+            info->aConstraintUsage[eq].omit = omit;
+            info->estimatedCost = std::log2(rows) + 10;
+            info->estimatedRows = 10;
+        }
+        else
+        {
+            if (lower >= 0)
+            {
+                plan |= PLAN_LOWER;
+                plan |= info->aConstraint[lower].op == SQLITE_INDEX_CONSTRAINT_GT ? PLAN_LOWER_STRICT : 0;
+                info->aConstraintUsage[lower].argvIndex = ++argv;
+                info->aConstraintUsage[lower].omit = omit;
+            }
+            if (upper >= 0)
+            {
+                plan |= PLAN_UPPER;
+                plan |= info->aConstraint[upper].op == SQLITE_INDEX_CONSTRAINT_LT ? PLAN_UPPER_STRICT : 0;
+                info->aConstraintUsage[upper].argvIndex = ++argv;
+                info->aConstraintUsage[upper].omit = omit;
+            }
+            double fraction = plan == 0 ? 1.0 : (lower >= 0 && upper >= 0 ? 0.1 : 0.33);
+            info->estimatedCost = std::log2(rows) + rows * fraction;
+            info->estimatedRows = static_cast<sqlite3_int64>(rows * fraction);
+        }
+        info->idxNum = plan | (plan != 0 ? key << PLAN_COLUMN_SHIFT : 0);
+
+        // Rows come out in container order, which is ascending on every sorted column
+        if (info->nOrderBy == 1 && !info->aOrderBy[0].desc && info->aOrderBy[0].iColumn >= 0 &&
+            module.is_sorted(info->aOrderBy[0].iColumn))
+        {
+            info->orderByConsumed = 1;
+        }
+        return SQLITE_OK;
+    }
+
+    static int open(sqlite3_vtab *, sqlite3_vtab_cursor **out)
+    {
+        auto *cur = new (std::nothrow) cursor();
+        if (cur == nullptr)
+        {
+            return SQLITE_NOMEM;
+        }
+        *out = cur;
+        return SQLITE_OK;
+    }
+
+    static int close(sqlite3_vtab_cursor *cur)
+    {
+        delete static_cast<cursor *>(cur);
+        return SQLITE_OK;
+    }
+
+    static int filter(sqlite3_vtab_cursor *base, int plan, const char *, int, sqlite3_value **argv)
+    {
+        auto *cur = static_cast<cursor *>(base);
+        vector_table_module &module = owner(base->pVtab);
+        std::span<const Record_T> rows = module.m_rows;
+        size_t lo = 0, hi = rows.size();
+
+        // Nothing compares true with NULL
+        int arguments = ((plan & PLAN_EQ) ? 1 : 0) + ((plan & PLAN_LOWER) ? 1 : 0) + ((plan & PLAN_UPPER) ? 1 : 0);
+        for (int i = 0; i < arguments; ++i)
+        {
+            if (sqlite3_value_type(argv[i]) == SQLITE_NULL)
+            {
+                hi = lo;
+            }
+        }
+
+        if ((plan & (PLAN_EQ | PLAN_LOWER | PLAN_UPPER)) != 0 && hi > lo)
+        {
+            module.visit(plan >> PLAN_COLUMN_SHIFT, [&](auto const &column) {
+                using key = std::decay_t<accessor_result<Record_T, decltype(column.accessor)>>;
+                if constexpr (is_key_type<key>)
+                {
+                    // First row whose key is at least (or strictly above) the value, or fallback
+                    auto first = [&](sqlite3_value *value, bool above, size_t fallback) {
+                        if (!bounds_rows<key>(value))
+                        {
+                            return fallback;
+                        }
+                        auto found = std::partition_point(rows.begin(), rows.end(), [&](Record_T const &row) {
+                            int order = compare_key(std::invoke(column.accessor, row), value);
+                            return above ? order <= 0 : order < 0;
+                        });
+                        return static_cast<size_t>(found - rows.begin());
+                    };
+
+                    int next = 0;
+                    if (plan & PLAN_EQ)
+                    {
+                        lo = first(argv[next], false, lo);
+                        hi = first(argv[next], true, hi);
+                        ++next;
+                    }
+                    if (plan & PLAN_LOWER)
+                    {
+                        lo = std::max(lo, first(argv[next++], (plan & PLAN_LOWER_STRICT) != 0, lo));
+                    }
+                    if (plan & PLAN_UPPER)
+                    {
+                        hi = std::min(hi, first(argv[next++], (plan & PLAN_UPPER_STRICT) == 0, hi));
+                    }
+                }
+            });
+        }
+
+        cur->position = lo;
+        cur->end = std::max(lo, hi);
+        return SQLITE_OK;
+    }
+
+    static int next(sqlite3_vtab_cursor *base)
+    {
+        ++static_cast<cursor *>(base)->position;
+        return SQLITE_OK;
+    }
+
+    static int eof(sqlite3_vtab_cursor *base)
+    {
+        auto *cur = static_cast<cursor *>(base);
+        return cur->position >= cur->end;
+    }
+
+    static int column_value(sqlite3_vtab_cursor *base, sqlite3_context *ctx, int i)
+    {
+        auto *cur = static_cast<cursor *>(base);
+        vector_table_module &module = owner(base->pVtab);
+        Record_T const &row = module.m_rows[cur->position];
+
+        try
+        {
+            module.visit(i, [&](auto const &column) {
+                using result = accessor_result<Record_T, decltype(column.accessor)>;
+                set_column_result<std::is_lvalue_reference<result>::value>(ctx, std::invoke(column.accessor, row));
+            });
+        }
+        catch (std::exception const &e)
+        {
+            sqlite3_result_error(ctx, e.what(), -1);
+        }
+        return SQLITE_OK;
+    }
+
+    static int rowid(sqlite3_vtab_cursor *base, sqlite3_int64 *out)
+    {
+        *out = static_cast<sqlite3_int64>(static_cast<cursor *>(base)->position);
+        return SQLITE_OK;
+    }
+
+public:
+    vector_table_module(std::span<const Record_T> rows, table_column<Accessors_T>... columns)
+        : m_rows(rows), m_columns(std::move(columns)...)
+    {
+        m_schema = "CREATE TABLE x(";
+        bool first = true;
+        std::apply([&](auto const &...column) {
+            ((m_schema += (first ? "" : ", "), m_schema += '"', m_schema += column.name, m_schema += "\" ",
+              m_schema += declared_type<std::decay_t<accessor_result<Record_T, decltype(column.accessor)>>>(),
+              first = false),
+             ...);
+        }, m_columns);
+        m_schema += ")";
+
+        // No xCreate makes the module eponymous-only: it is a table by its own name
+        m_module.iVersion = 1;
+        m_module.xConnect = &connect;
+        m_module.xBestIndex = &best_index;
+        m_module.xDisconnect = &disconnect;
+        m_module.xDestroy = &disconnect;
+        m_module.xOpen = &open;
+        m_module.xClose = &close;
+        m_module.xFilter = &filter;
+        m_module.xNext = &next;
+        m_module.xEof = &eof;
+        m_module.xColumn = &column_value;
+        m_module.xRowid = &rowid;
+    }
+
+    sqlite3_module const *module() const
+    {
+        return &m_module;
+    }
+};
+
+} // namespace detail
+
+/*
+ * Makes rows queryable as a read-only table called name, without copying
+ * them into SQLite:
+ *
+ *   create_vector_table(db, "prices", std::span<const price>(prices),
+ *                       sorted_column("id", &price::id), column("value", &price::value));
+ *   query<long, double>(db, "SELECT p.id, p.value FROM prices p JOIN orders o ON o.price_id = p.id");
+ *
+ * Equality and range constraints on a sorted column are answered by binary
+ * search, and ORDER BY on it needs no sort. Comparisons follow the column's
+ * affinity, so id = '10' finds the row with id 10. Text and blob members are
+ * passed to SQLite in place. The rows must stay valid and unchanged for as
+ * long as the connection is open.
+ */
+template <typename Record_T, typename... Accessors_T>
+void create_vector_table(connection &db, const char *name, std::span<const Record_T> rows,
+                         table_column<Accessors_T>... columns)
+{
+    using module_type = detail::vector_table_module<Record_T, Accessors_T...>;
+
+    auto *module = new module_type(rows, std::move(columns)...);
+    // SQLite calls the destroy callback itself if registering fails
+    int rc = sqlite3_create_module_v2(static_cast<sqlite3 *>(db), name, module->module(), module,
+                                      &detail::destroy_user_data<module_type>);
+    if (database_exception::is_error_code(rc))
+    {
+        throw database_exception(sqlite3_errmsg(static_cast<sqlite3 *>(db)));
+    }
+}
+
+}; // namespace sqlite_connect
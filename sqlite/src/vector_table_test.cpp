@@ -0,0 +1,79 @@
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "sqlite_connect/sqlite_connect.hpp"
+
+struct item
+{
+    long long id;
+    double weight;
+    std::string name;
+};
+
+static long long count(sqlite_connect::connection &db, std::string const &sql)
+{
+    long long rows = 0;
+    for (auto [n] : sqlite_connect::query<long long>(db, sql.c_str()))
+    {
+        rows = n;
+    }
+    return rows;
+}
+
+/*
+ * A sorted column answers constraints by binary search, which must give the
+ * rows SQLite's own comparison gives on the same data scanned unsorted.
+ */
+int main()
+{
+    std::vector<item> items = {{5, 5.0, "1"}, {10, 10.0, "10"}, {15, 15.0, "5"}};
+    std::span<const item> rows(items);
+
+    sqlite_connect::connection db;
+    sqlite_connect::create_vector_table(db, "sorted", rows, sqlite_connect::sorted_column("id", &item::id),
+                                        sqlite_connect::sorted_column("weight", &item::weight),
+                                        sqlite_connect::sorted_column("name", &item::name));
+    sqlite_connect::create_vector_table(db, "unsorted", rows, sqlite_connect::column("id", &item::id),
+                                        sqlite_connect::column("weight", &item::weight),
+                                        sqlite_connect::column("name", &item::name));
+    db.execute_query("CREATE TABLE numbers (n INTEGER, t TEXT)");
+    db.execute_query("INSERT INTO numbers VALUES (10, '10'), (5, '5'), (1, '01')");
+
+    const char *constraints[] = {
+        "id = 10", "id = '10'", "id = '10.0'", "id > '7'", "id < '12'", "id BETWEEN '6' AND '11'", "id >= 10.5",
+        "id = 'x'", "id < 'x'", "id = NULL", "weight = '10'", "weight > '7'", "weight <= 10",
+        "name = '10'", "name = 10", "name > 2", "name < 5", "name BETWEEN 1 AND 5", "name >= '5'",
+        "id IN (SELECT n FROM numbers)", "id IN (SELECT t FROM numbers)", "name IN (SELECT n FROM numbers)",
+        "name IN (SELECT t FROM numbers)",
+    };
+
+    int failures = 0;
+    for (const char *constraint : constraints)
+    {
+        long long sorted = count(db, std::string("SELECT count(*) FROM sorted WHERE ") + constraint);
+        long long unsorted = count(db, std::string("SELECT count(*) FROM unsorted WHERE ") + constraint);
+        if (sorted != unsorted)
+        {
+            std::cout << "FAIL " << constraint << ": sorted " << sorted << " rows, unsorted " << unsorted << "\n";
+            ++failures;
+        }
+    }
+
+    const char *joins[] = {"JOIN numbers ON v.id = numbers.n", "JOIN numbers ON v.id = numbers.t",
+                           "JOIN numbers ON v.name = numbers.n", "JOIN numbers ON v.name = numbers.t"};
+    for (const char *join : joins)
+    {
+        long long sorted = count(db, std::string("SELECT count(*) FROM sorted v ") + join);
+        long long unsorted = count(db, std::string("SELECT count(*) FROM unsorted v ") + join);
+        if (sorted != unsorted)
+        {
+            std::cout << "FAIL " << join << ": sorted " << sorted << " rows, unsorted " << unsorted << "\n";
+            ++failures;
+        }
+    }
+
+    std::cout << (failures == 0 ? "vector_table: ok\n" : "vector_table: failed\n");
+    return failures == 0 ? 0 : 1;
+}